@@ -1,15 +1,18 @@
 from triton.backends.compiler import BaseBackend, GPUTarget
-from triton._C.libtriton import ir, passes
+from triton._C.libtriton import ir, llvm, passes, triton_shared
 from dataclasses import dataclass
 from typing import Any, Dict, Tuple
 from types import ModuleType
 import hashlib
 import tempfile
 import os
+import platform
 import re
 import shutil
+import struct
 import subprocess
 import functools
+from concurrent.futures import ThreadPoolExecutor
 from pathlib import Path
 
 def _get_triton_shared_opt_path() -> str:
@@ -26,73 +29,159 @@ def _get_llvm_bin_path(bin_name: str) -> str:
     return os.path.join(path, bin_name)
 
 
+def _use_external_tools() -> bool:
+    # Run the lowering through triton-shared-opt and mlir-translate instead of
+    # in process. Mostly useful to debug the lowering with the exact same tools
+    # as the lit tests.
+    return os.getenv("TRITON_SHARED_USE_EXTERNAL_TOOLS", "0") == "1"
+
+
+def _dump_path() -> str:
+    return os.getenv("TRITON_SHARED_DUMP_PATH", "")
+
+
 def _dump_ir_if_needed(files):
-    path = os.getenv("TRITON_SHARED_DUMP_PATH", "")
+    path = _dump_path()
     if not path:
         return
     for f in files:
         shutil.copy(f, os.path.join(path, os.path.basename(f)))
 
 
+def _dump_text_if_needed(name, module):
+    # Stages exchange modules in memory or as bytecode, they are only printed
+    # as text here.
+    path = _dump_path()
+    if not path:
+        return
+    Path(os.path.join(path, name)).write_text(str(module))
+
+
+def _cpu_pipeline(options) -> str:
+    # The lowering from ttsharedir to the LLVM dialect, as a textual pass
+    # pipeline. See include/triton-shared/Pipelines/Pipelines.h for the options.
+    pipeline_options = []
+    if options.grid_as_loop:
+        pipeline_options.append("grid-as-loop=true")
+    if options.matmul_library:
+        pipeline_options.append("matmul-library=true")
+    if options.vectorize:
+        pipeline_options.append("vectorize=true")
+        pipeline_options.append(f"vector-size={options.vector_size}")
+    if options.tile_sizes:
+        pipeline_options.append("tile-sizes=" + ",".join(str(size) for size in options.tile_sizes))
+    pipeline_options.append(f"bufferization-mode={options.bufferization_mode}")
+    if options.target_features:
+        pipeline_options.append(f"target-features={options.target_features}")
+    return "triton-shared-cpu-pipeline{" + " ".join(pipeline_options) + "}"
+
+
 def _ttir_to_ttsharedir(mod):
-    # Get Triton-MLIR as string
-    ttir_code = str(mod)
+    _dump_text_if_needed("tt.mlir", mod)
+    pm = ir.pass_manager(mod.context)
+    pm.enable_debug()
+    triton_shared.passes.add_triton_to_linalg_experimental(pm)
+    triton_shared.passes.run(pm, mod)
+    return mod
+
+
+def _ttir_to_ttsharedir_external(mod):
     with tempfile.TemporaryDirectory() as tmpdir:
-        src_path = os.path.join(tmpdir, "tt.mlir")
-        dst_path = os.path.join(tmpdir, "ttshared.mlir")
-        Path(src_path).write_text(ttir_code)
+        src_path = os.path.join(tmpdir, "tt.mlirbc")
+        dst_path = os.path.join(tmpdir, "ttshared.mlirbc")
+        Path(src_path).write_bytes(triton_shared.write_bytecode(mod))
+        _dump_text_if_needed("tt.mlir", mod)
         triton_shared_opt_path = _get_triton_shared_opt_path()
-        subprocess.check_call([triton_shared_opt_path, src_path, "--triton-to-linalg-experimental", "--mlir-print-debuginfo", "-o", dst_path])
-        _dump_ir_if_needed([src_path])
-        return Path(dst_path).read_text()
+        subprocess.check_call([triton_shared_opt_path, src_path, "--triton-to-linalg-experimental", "--emit-bytecode", "-o", dst_path])
+        return triton_shared.parse_bytecode(Path(dst_path).read_bytes(), mod.context)
+
+
+def _vector_bits(options) -> int:
+    # Width of the widest vector registers of the target, from its features.
+    if options.vector_bits:
+        return options.vector_bits
+    features = ",".join(f for f in (options.features, options.target_features) if f).split(",")
+    if "+avx512f" in features:
+        return 512
+    if "+avx" in features:
+        return 256
+    return 128
+
+
+def _ttsharedir_pipeline(options) -> str:
+    # Optimizations of ttsharedir, i.e. on tensors before bufferization, as a
+    # textual pass pipeline.
+    pipeline = []
+    if options.fuse_elementwise:
+        pipeline.append("triton-shared-fuse-elementwise")
+    if options.tile_and_fuse:
+        pipeline.append(f"triton-shared-tile-and-fuse{{cache-size={options.cache_size or 2**20}}}")
+    if options.vectorize_linalg:
+        pipeline.append(f"triton-shared-vectorize-linalg{{vector-bits={_vector_bits(options)}}}")
+    return ",".join(pipeline)
+
+
+def _optimize_ttsharedir(ttsharedir, options):
+    pipeline = _ttsharedir_pipeline(options)
+    if not pipeline:
+        return ttsharedir
+    pm = ir.pass_manager(ttsharedir.context)
+    pm.enable_debug()
+    triton_shared.passes.add_pipeline(pm, pipeline)
+    triton_shared.passes.run(pm, ttsharedir)
+    return ttsharedir
 
 
-def _optimize_ttsharedir(ttsharedir: str):
-    # We don't apply any optimizations now, but we can add passes if needed.
-    return ttsharedir
+def _optimize_ttsharedir_external(ttsharedir, options):
+    pipeline = _ttsharedir_pipeline(options)
+    if not pipeline:
+        return ttsharedir
+    with tempfile.TemporaryDirectory() as tmpdir:
+        src_path = os.path.join(tmpdir, "ttshared.mlirbc")
+        dst_path = os.path.join(tmpdir, "ttshared.opt.mlirbc")
+        Path(src_path).write_bytes(triton_shared.write_bytecode(ttsharedir))
+        triton_shared_opt_path = _get_triton_shared_opt_path()
+        subprocess.check_call([triton_shared_opt_path, src_path, f"--pass-pipeline=builtin.module({pipeline})", "--emit-bytecode", "-o", dst_path])
+        return triton_shared.parse_bytecode(Path(dst_path).read_bytes(), ttsharedir.context)
+
+
+def _ttsharedir_to_llir(mod, options):
+    _dump_text_if_needed("ttshared.mlir", mod)
+    # TritonShared-MLIR to LLVM-MLIR
+    pm = ir.pass_manager(mod.context)
+    pm.enable_debug()
+    triton_shared.passes.add_pipeline(pm, _cpu_pipeline(options))
+    triton_shared.passes.run(pm, mod)
+    _dump_text_if_needed("ll.mlir", mod)
+
+    # LLVM-MLIR to LLVM-IR
+    context = llvm.context()
+    llvm_mod = llvm.to_module(mod, context)
+    if llvm_mod is None:
+        raise RuntimeError("Failed to translate the kernel to LLVM IR")
+    llir = str(llvm_mod)
+    del llvm_mod
+    del context
+    _dump_text_if_needed("ll.ir", llir)
+    return llir
 
 
-def _ttsharedir_to_llir(ttsharedir: str):
+def _ttsharedir_to_llir_external(mod, options):
+    _dump_text_if_needed("ttshared.mlir", mod)
     with tempfile.TemporaryDirectory() as tmpdir:
-        ttshared_path = os.path.join(tmpdir, "ttshared.mlir")
-        llmlir_path = os.path.join(tmpdir, "ll.mlir")
+        ttshared_path = os.path.join(tmpdir, "ttshared.mlirbc")
+        llmlir_path = os.path.join(tmpdir, "ll.mlirbc")
         llir_path = os.path.join(tmpdir, "ll.ir")
-        Path(ttshared_path).write_text(ttsharedir)
-        mlir_opt_path = _get_llvm_bin_path("mlir-opt")
+        Path(ttshared_path).write_bytes(triton_shared.write_bytecode(mod))
+        triton_shared_opt_path = _get_triton_shared_opt_path()
         # TritonShared-MLIR to LLVM-MLIR
-        subprocess.check_call([mlir_opt_path, ttshared_path,
-            "--convert-linalg-to-affine-loops",
-            # Note: eliminate-empty-tensors fails when there are multiple func.return ops
-            # in a single kernel which are the results of early returns.
-            # See python/examples/test_early_return.py for examples.
-            # We disable this pass for now since performance on CPU isn't the main
-            # focus at the moment.
-            # "--eliminate-empty-tensors",
-            "--empty-tensor-to-alloc-tensor",
-            "--one-shot-bufferize=allow-return-allocs-from-loops=true",
-            "--lower-affine",
-            "--convert-linalg-to-loops",
-            "--expand-strided-metadata",
-            "--convert-scf-to-cf",
-            "--convert-arith-to-llvm",
-            "--convert-math-to-llvm",
-            "--convert-complex-to-llvm",
-            "--convert-vector-to-llvm",
-            "--convert-index-to-llvm",
-            "--memref-expand",
-            "--finalize-memref-to-llvm",
-            "--convert-func-to-llvm",
-            "--convert-cf-to-llvm",
-            # Lowering memrefs creates more affine.apply ops.
-            # Lowering these affine ops again creates further arith ops,
-            # so we have to run these two passes again here.
-            "--lower-affine",
-            "--convert-arith-to-llvm",
-            # Remove all unrealized casts created
-            "--reconcile-unrealized-casts",
-            "--mlir-print-debuginfo",
+        subprocess.check_call([triton_shared_opt_path, ttshared_path,
+            f"--pass-pipeline=builtin.module({_cpu_pipeline(options)})",
+            "--emit-bytecode",
             "-o",
             llmlir_path])
+        if _dump_path():
+            _dump_text_if_needed("ll.mlir", triton_shared.parse_bytecode(Path(llmlir_path).read_bytes(), mod.context))
 
         # LLVM-MLIR to LLVM-IR
         mlir_translate_path = _get_llvm_bin_path("mlir-translate")
@@ -100,35 +189,89 @@ def _ttsharedir_to_llir(ttsharedir: str):
             "--mlir-to-llvmir",
             "-o",
             llir_path])
-        _dump_ir_if_needed([ttshared_path, llmlir_path, llir_path])
+        _dump_ir_if_needed([llir_path])
         return Path(llir_path).read_text()
 
 
-def _optimize_llir(llir: str):
-    # We don't apply any optimizations now, but we can add passes if needed.
-    return llir
+def _optimize_llir(llir: str, options):
+    if options.fat_binary:
+        # Every variant is optimized for its own ISA level in _llir_to_bin.
+        return llir
+    return triton_shared.llvm.optimize_module(llir, options.arch, options.features, options.opt_level)
 
 
-def _llir_to_bin(llir: str, metadata):
-    pattern = r"define void @(\w+)\(.+"
-    matches = re.findall(pattern, llir)
-    assert len(matches) == 1
-    metadata["name"] = matches[0]
+def _add_packed_entry(llir: str, name: str):
+    # The CPU runtime launches every kernel through a packed entry point
+    # `void _mlir_<name>(ptr %args)` where args[i] holds the address of the i-th
+    # kernel argument, the same convention as the packed functions of the MLIR
+    # ExecutionEngine. See backend/include/Runtime/Launcher.h. The entry point
+    # is built on the parsed module, from the types of the kernel arguments.
+    return triton_shared.llvm.add_packed_entry(llir, name)
+
+
+# ISA levels of the variants of a fat binary, most capable first: AVX-512,
+# AVX2 and SSE4.2.
+_FAT_BINARY_ISAS = ("x86-64-v4", "x86-64-v3", "x86-64-v2")
+
+
+def _pack_fat_binary(variants):
+    # See backend/include/Runtime/KernelLoader.h for the layout.
+    data = bytearray(b"TSFATBIN")
+    data += struct.pack("<I", len(variants))
+    for isa, binary in variants:
+        data += struct.pack("<I", len(isa)) + isa.encode("utf-8")
+        data += struct.pack("<Q", len(binary)) + binary
+    return bytes(data)
+
+
+def _compile_llir(llir: str, name: str, cpu: str, features: str, options):
+    llir = _add_packed_entry(llir, name)
+    if options.jit:
+        # The CPU runtime compiles the IR in process when the kernel is loaded.
+        return llir.encode("utf-8")
     with tempfile.TemporaryDirectory() as tmpdir:
         src_path = os.path.join(tmpdir, "kernel.ll")
         dst_path = os.path.join(tmpdir, "kernel.o")
         Path(src_path).write_text(llir)
         llc_path = _get_llvm_bin_path("llc")
-        subprocess.check_call([llc_path, src_path, "-o", dst_path])
-        # Actually it's text-format assembly.  Use read_text().
-        return Path(dst_path).read_text()
+        # The object is linked into the process by the CPU runtime, so it has
+        # to be position independent.
+        args = [llc_path, src_path, "-filetype=obj", "-relocation-model=pic", f"-O{options.opt_level}"]
+        if cpu:
+            args.append(f"-mcpu={cpu}")
+        if features:
+            args.append(f"-mattr={features}")
+        subprocess.check_call(args + ["-o", dst_path])
+        return Path(dst_path).read_bytes()
+
+
+def _llir_to_bin(llir: str, metadata, options):
+    pattern = r"define void @(\w+)\(.+"
+    matches = re.findall(pattern, llir)
+    assert len(matches) == 1
+    metadata["name"] = matches[0]
+    if not options.fat_binary:
+        return _compile_llir(llir, metadata["name"], options.arch, options.features, options)
 
+    def compile_variant(isa):
+        variant = triton_shared.llvm.optimize_module(llir, isa, options.features, options.opt_level)
+        return isa, _compile_llir(variant, metadata["name"], isa, options.features, options)
+
+    with ThreadPoolExecutor(max_workers=len(_FAT_BINARY_ISAS)) as pool:
+        return _pack_fat_binary(list(pool.map(compile_variant, _FAT_BINARY_ISAS)))
 
 
 @dataclass(frozen=True)
 class CPUOptions:
     debug: bool = False
+    # LLVM CPU name the kernels are compiled for, "native" for the host CPU.
     arch: str = None
+    # Extra LLVM target features, e.g. "+avx2,-avx512f".
+    features: str = ""
+    opt_level: int = 3
+    # Compile one variant per x86-64 ISA level and pick the best one for the
+    # host CPU when loading the kernel. `arch` is ignored.
+    fat_binary: bool = False
     num_warps: int = 0
     num_ctas: int = 0
     num_stages: int = 1
@@ -143,6 +286,31 @@ class CPUOptions:
     allow_fp8e4nv: bool = False
     allowed_dot_input_precisions: Tuple[str] = ("ieee", )
     sanitize_overflow: bool = True
+    # Hand the LLVM IR to the CPU runtime, which compiles it in process with
+    # ORC, instead of producing an object with llc.
+    jit: bool = False
+    # Options of the triton-shared-cpu-pipeline lowering to LLVM.
+    # Run the programs of a chunk of the launch grid in a loop inside the
+    # kernel instead of calling the kernel once per program.
+    grid_as_loop: bool = False
+    # Compute tt.dot ops with the packed matrix multiplication of the runtime.
+    matmul_library: bool = False
+    # Fuse chains of elementwise linalg ops of ttsharedir into single ops.
+    fuse_elementwise: bool = False
+    # Tile chains of linalg ops of ttsharedir so that a tile touches at most
+    # `cache_size` bytes, 0 for the L2 cache of the host.
+    tile_and_fuse: bool = False
+    cache_size: int = 0
+    # Vectorize elementwise and reduction linalg ops of ttsharedir before
+    # bufferization, with vectors of `vector_bits` bits, 0 for the widest
+    # registers of the target.
+    vectorize_linalg: bool = False
+    vector_bits: int = 0
+    vectorize: bool = False
+    vector_size: int = 8
+    tile_sizes: Tuple[int] = ()
+    bufferization_mode: str = "one-shot"
+    target_features: str = ""
 
     def __post_init__(self):
         pass
@@ -153,6 +321,8 @@ class CPUOptions:
 
 
 class CPUBackend(BaseBackend):
+    # Kept as 'cpuasm' for compatibility even though the stage now produces a
+    # relocatable object, or LLVM IR when the `jit` option is set.
     binary_ext = 'cpuasm'
 
     @staticmethod
@@ -163,8 +333,31 @@ class CPUBackend(BaseBackend):
         super().__init__(target)
 
     def parse_options(self, opts) -> Any:
-        args = {'arch': self.target.arch}
+        args = {'arch': os.getenv("TRITON_SHARED_CPU_ARCH", "native")}
+        args['jit'] = os.getenv("TRITON_SHARED_JIT", "0") == "1"
+        args['fat_binary'] = os.getenv("TRITON_SHARED_FAT_BINARY", "0") == "1"
+        args['grid_as_loop'] = os.getenv("TRITON_SHARED_GRID_AS_LOOP", "0") == "1"
+        args['matmul_library'] = os.getenv("TRITON_SHARED_MATMUL_LIBRARY", "0") == "1"
+        args['fuse_elementwise'] = os.getenv("TRITON_SHARED_FUSE_ELEMENTWISE", "0") == "1"
+        args['tile_and_fuse'] = os.getenv("TRITON_SHARED_TILE_AND_FUSE", "0") == "1"
+        args['vectorize_linalg'] = os.getenv("TRITON_SHARED_VECTORIZE_LINALG", "0") == "1"
         args.update({k: opts[k] for k in CPUOptions.__dataclass_fields__.keys() if k in opts})
+        if args.get('tile_and_fuse') and not args.get('cache_size'):
+            # Part of the cache key, like the host CPU below.
+            args['cache_size'] = triton_shared.runtime.get_cpu_properties()["l2_cache_size"]
+        if args['fat_binary']:
+            if platform.machine().lower() not in ("x86_64", "amd64"):
+                # The variants are x86-64 ISA levels, see _FAT_BINARY_ISAS.
+                raise ValueError(f"fat_binary is only supported on x86-64 hosts, not {platform.machine()}")
+            # Fat binaries run on any x86-64 host, keep them out of the
+            # host-specific part of the cache key.
+            args['arch'] = None
+        elif args['arch'] == "native":
+            # Spell the host CPU out so that kernels compiled on different
+            # hosts get different cache entries.
+            args['arch'] = triton_shared.llvm.get_host_cpu_name()
+            args['features'] = ",".join(
+                f for f in (triton_shared.llvm.get_host_cpu_features(), args.get('features', "")) if f)
         return CPUOptions(**args)
 
     def get_codegen_implementation(self, options):
@@ -185,10 +378,10 @@ class CPUBackend(BaseBackend):
             metadata.name
         )
 
-    # Our compilation pipeline isn't in python like nvidia or amd, no need to load
-    # dialects. See `triton_shared.cc`
+    # Registers the triton-shared dialects and the upstream dialects the
+    # lowering goes through. See `triton_shared.cc`
     def load_dialects(self, ctx):
-        return
+        triton_shared.load_dialects(ctx)
 
     @staticmethod
     def make_ttir(mod, metadata, opt):
@@ -204,11 +397,18 @@ class CPUBackend(BaseBackend):
         pm.run(mod)
         return mod
 
+    # Only the external tools exchange modules as bytecode. In process, the
+    # stages hand modules over in memory; the textual ttir and ttsharedir cache
+    # entries are written by Triton itself from the module each stage returns.
     def add_stages(self, stages, options):
         stages["ttir"] = lambda src, metadata: self.make_ttir(src, metadata, options)
-        stages["ttsharedir"] = lambda src, metadata: _optimize_ttsharedir(_ttir_to_ttsharedir(src))
-        stages["llir"] = lambda src, metadata: _optimize_llir(_ttsharedir_to_llir(src))
-        stages["cpuasm"] = lambda src, metadata: _llir_to_bin(src, metadata)
+        if _use_external_tools():
+            stages["ttsharedir"] = lambda src, metadata: _optimize_ttsharedir_external(_ttir_to_ttsharedir_external(src), options)
+            stages["llir"] = lambda src, metadata: _optimize_llir(_ttsharedir_to_llir_external(src, options), options)
+        else:
+            stages["ttsharedir"] = lambda src, metadata: _optimize_ttsharedir(_ttir_to_ttsharedir(src), options)
+            stages["llir"] = lambda src, metadata: _optimize_llir(_ttsharedir_to_llir(src, options), options)
+        stages["cpuasm"] = lambda src, metadata: _llir_to_bin(src, metadata, options)
 
 
     @functools.lru_cache()
@@ -1,16 +1,10 @@
-import hashlib
-import tempfile
-import sysconfig
+import threading
 
-import os, subprocess, tempfile
-import importlib.util
-import sysconfig
-
-from pathlib import Path
-
-from triton.runtime.cache import get_cache_manager
 from triton.backends.driver import DriverBase
 from triton.backends.compiler import GPUTarget
+from triton._C.libtriton import triton_shared
+from triton.backends.triton_shared.graph import capturing_graph
+from triton.backends.triton_shared.stream import current_stream
 
 # -------------------- Launcher ----------------------------
 def _ty_to_cpp(ty):
@@ -36,13 +30,6 @@ def _ty_to_cpp(ty):
         "fp64": "double",
     }[ty]
 
-def _extracted_type(ty):
-    if ty[0] == '*':
-        return "PyObject*"
-    if ty == "constexpr":
-        return "PyObject*"
-    return _ty_to_cpp(ty)
-
 def _format_of(ty):
     return {
       "PyObject*": "O",
@@ -60,249 +47,51 @@ def _format_of(ty):
       "uint64_t": "K",
     }[ty]
 
-def _generate_launcher(constants, signature, kernel_name):
-    arg_decls = ', '.join(f"{_ty_to_cpp(ty)} arg{i}" for i, ty in signature.items())
-    args_format = ''.join([_format_of(_extracted_type(ty)) for ty in signature.values()])
-    format = "iiiOOOO" + args_format
-    args_list = ', ' + ', '.join(f"&_arg{i}" for i, ty in signature.items()) if len(signature) > 0 else ''
-
-    kernel_arg_decls = ', '.join(_ty_to_cpp(ty) if ty[0] != "*" else f"int64_t, void*" for i, ty in signature.items() if ty != "constexpr")
-    kernel_arg_decls += ', ' if kernel_arg_decls else ''
-
-    kernel_parameters = ', '.join(f"static_cast<{_ty_to_cpp(ty)}>(arg{i})" if ty[0] != "*" else f"0, &ptr_arg{i}" for i, ty in signature.items() if ty != "constexpr")
-    kernel_parameters += ', ' if kernel_parameters else ''
-
-    return f"""
-#include <assert.h>
-#include <stdbool.h>
-#include <Python.h>
-#include "ExecutionEngine/CRunnerUtils.h"
-#include "ExecutionEngine/CRunnerUtils.cpp"
-
-extern "C" {{
-  // Pointer type (=Memref) becomes int64_t + MemRef struct
-  // FIXME: understand what this int64_t is used for.
-  void {kernel_name}({kernel_arg_decls}
-                       int, int, int, int, int, int);
-}}
-
-static void _launch(int gridX, int gridY, int gridZ, {arg_decls}) {{
-  if (gridX*gridY*gridZ > 0) {{
-    // Cast "function" to the real function type.
-    for(int x = 0; x < gridX; x++) {{
-      for(int y = 0; y < gridY; y++) {{
-        for(int z = 0; z < gridZ; z++) {{
-          // Use some random type "char" here.
-          {' '.join(f'StridedMemRefType<char, 0> ptr_arg{i} = {{static_cast<char *>(arg{i}), static_cast<char *>(arg{i}), 0}};' for i, ty in signature.items() if i not in constants and ty[0] == "*")}
-          {kernel_name}({kernel_parameters}
-                        gridX, gridY, gridZ, x, y, z);
-        }}
-      }}
-    }}
-  }}
-}}
-
-typedef struct _DevicePtrInfo {{
-  void *dev_ptr;
-  bool valid;
-}} DevicePtrInfo;
-
-static inline DevicePtrInfo getPointer(PyObject *obj, int idx) {{
-  DevicePtrInfo ptr_info;
-  ptr_info.dev_ptr = 0;
-  ptr_info.valid = true;
-  if (PyLong_Check(obj)) {{
-    ptr_info.dev_ptr = reinterpret_cast<void *>(PyLong_AsUnsignedLongLong(obj));
-    return ptr_info;
-  }}
-  if (obj == Py_None) {{
-    // valid nullptr
-    return ptr_info;
-  }}
-  PyObject *ptr = PyObject_GetAttrString(obj, "data_ptr");
-  if(ptr){{
-    PyObject *empty_tuple = PyTuple_New(0);
-    PyObject *ret = PyObject_Call(ptr, empty_tuple, NULL);
-    Py_DECREF(empty_tuple);
-    Py_DECREF(ptr);
-    if (!PyLong_Check(ret)) {{
-      PyErr_SetString(PyExc_TypeError, "data_ptr method of Pointer object must return 64-bit int");
-      ptr_info.valid = false;
-      return ptr_info;
-    }}
-    ptr_info.dev_ptr = reinterpret_cast<void *>(PyLong_AsUnsignedLongLong(ret));
-    if(!ptr_info.dev_ptr)
-      return ptr_info;
-    Py_DECREF(ret);  // Thanks ChatGPT!
-    return ptr_info;
-  }}
-  PyErr_SetString(PyExc_TypeError, "Pointer argument must be either uint64 or have data_ptr method");
-  return ptr_info;
-}}
-
-static PyObject* launch(PyObject* self, PyObject* args) {{
-  int gridX, gridY, gridZ;
-  PyObject *launch_enter_hook = NULL;
-  PyObject *launch_exit_hook = NULL;
-  PyObject *kernel_metadata = NULL;
-  PyObject *launch_metadata = NULL;
-  {' '.join([f"{_extracted_type(ty)} _arg{i}; " for i, ty in signature.items()])}
-  if(!PyArg_ParseTuple(args, \"{format}\", &gridX, &gridY, &gridZ,
-                                           &kernel_metadata, &launch_metadata,
-                                           &launch_enter_hook, &launch_exit_hook {args_list})) {{
-    return NULL;
-  }}
-
-  // [CPULauncher-specific]: We don't need the metadata below but just put them
-  // here anyway to be consistent with others.
-  // This will make updating the driver easier in the future.
-
-  //  int num_warps, num_ctas, shared_memory, clusterDimX, clusterDimY, clusterDimZ;
-  //  if (!PyArg_ParseTuple(kernel_metadata, \"iiiiii\", &num_warps, &num_ctas, &shared_memory, &clusterDimX, &clusterDimY, &clusterDimZ)) {{
-  //    PyErr_SetString(PyExc_TypeError, "kernel_metadata must be a tuple");
-  //    return NULL;
-  //  }}
-
-  // extract launch metadata
-  if (launch_enter_hook != Py_None){{
-    PyObject* args = Py_BuildValue("(O)", launch_metadata);
-    PyObject* ret = PyObject_CallObject(launch_enter_hook, args);
-    Py_DECREF(args);
-    if (!ret)
-      return NULL;
-  }}
-
-  // raise exception asap
-  {"; ".join([f"DevicePtrInfo ptr_info{i} = getPointer(_arg{i}, {i}); if (!ptr_info{i}.valid) return NULL;" if ty[0] == "*" else "" for i, ty in signature.items()])};
-  _launch(gridX, gridY, gridZ, {', '.join(f"ptr_info{i}.dev_ptr" if ty[0]=="*" else f"_arg{i}"for i, ty in signature.items())});
-
-  if (PyErr_Occurred()) {{
-    return NULL;
-  }}
-  if(launch_exit_hook != Py_None){{
-    PyObject* args = Py_BuildValue("(O)", launch_metadata);
-    PyObject* ret = PyObject_CallObject(launch_exit_hook, args);
-    Py_DECREF(args);
-    if (!ret)
-      return NULL;
-  }}
-
-  // return None
-  Py_INCREF(Py_None);
-  return Py_None;
-}}
-
-static PyMethodDef ModuleMethods[] = {{
-  {{"launch", launch, METH_VARARGS, "Entry point for all kernels with this signature"}},
-  {{NULL, NULL, 0, NULL}} // sentinel
-}};
-
-static struct PyModuleDef ModuleDef = {{
-  PyModuleDef_HEAD_INIT,
-  \"__triton_shared_ref_cpu_kernel_launcher\",
-  NULL, //documentation
-  -1, //size
-  ModuleMethods
-}};
-
-PyMODINIT_FUNC PyInit___triton_shared_ref_cpu_kernel_launcher(void) {{
-  PyObject *m = PyModule_Create(&ModuleDef);
-  if(m == NULL) {{
-    return NULL;
-  }}
-  PyModule_AddFunctions(m, ModuleMethods);
-  return m;
-}}
-"""
-
-
-def compile_module(launcher_src, kernel_placeholder_name):
-    # This function was renamed and made public in Python 3.10
-    if hasattr(sysconfig, 'get_default_scheme'):
-        scheme = sysconfig.get_default_scheme()
-    else:
-        scheme = sysconfig._get_default_scheme()
-    # 'posix_local' is a custom scheme on Debian. However, starting Python 3.10, the default install
-    # path changes to include 'local'. This change is required to use triton with system-wide python.
-    if scheme == 'posix_local':
-        scheme = 'posix_prefix'
-    py_include_dir = sysconfig.get_paths(scheme=scheme)["include"]
-    py_lib_dir = sysconfig.get_config_var("LIBDIR")
-    py_version = sysconfig.get_config_var("LDVERSION")
-    py_lib = '{name}{py_version}'.format(name="python", py_version=py_version)
-    cpu_backend_path = Path(__file__).resolve().parent
-    include_dir = os.path.join(cpu_backend_path, "include")
-
-    def launch(
-        gridX, gridY, gridZ, stream, cu_function,
-        kernel_metadata, launch_metadata,
-        launch_enter_hook, launch_exit_hook, *args):
-        # Unlike CUDA/HIP, we cannot easily pass function pointer across different pybind libraries.
-        # Let's compile a kernel every time.
-        # The cu_function parameter actually contains our assembly source code.
-        # See CPUUtils.load_binary method.
-        asm_src = cu_function
-        kernel_name = kernel_metadata[6] # see pack_metadata in compiler.py
-        src = launcher_src.replace(kernel_placeholder_name, kernel_name)
-
-        key = hashlib.md5(src.encode("utf-8") + asm_src).hexdigest()
-        cache = get_cache_manager(key)
-        name = "__triton_shared_ref_cpu_kernel_launcher"
-        filename = f"{name}.so"
-        cache_path = cache.get_file(filename)
-
-        if cache_path is None:
-          with tempfile.TemporaryDirectory() as tmpdir:
-              asm_src_path = os.path.join(tmpdir, "kernel.s")
-              launcher_src_path = os.path.join(tmpdir, "main.cxx")
-              so_path = os.path.join(tmpdir, "kernel.so")
-              Path(asm_src_path).write_bytes(asm_src)
-              Path(launcher_src_path).write_text(src)
-              # Compile it together.
-              subprocess.check_call([
-                "g++", "-std=c++17", launcher_src_path, asm_src_path,
-                f"-I{py_include_dir}", f"-I{include_dir}", f"-L{py_lib_dir}",
-                "-shared", f"-l{py_lib}", "-fPIC", "-o", so_path
-              ])
-
-              with open(so_path, "rb") as f:
-                cache_path = cache.put(f.read(), filename, binary=True)
-
-        # Load and launch the compiled kernel.
-        spec = importlib.util.spec_from_file_location(name, cache_path)
-        mod = importlib.util.module_from_spec(spec)
-        spec.loader.exec_module(mod)
-        return mod.launch(gridX, gridY, gridZ,
-                          kernel_metadata, launch_metadata,
-                          launch_enter_hook, launch_exit_hook,
-                          *args)
-
-    return launch
+def _signature_descriptor(signature):
+    # One character per kernel argument, see backend/include/Runtime/Launcher.h.
+    return ''.join('P' if ty[0] == '*' else _format_of(_ty_to_cpp(ty)) for ty in signature.values())
 
 
 class CPULauncher(object):
+    # Triton builds one launcher per compiled kernel, and load_binary links the
+    # kernel once, so everything that does not depend on the launch arguments
+    # is resolved here; a launch only marshals its arguments.
 
     def __init__(self, src, metadata):
-        kernel_placeholder_name = "KERNEL_NAME_PLACEHOLDER"
-
-        constants = src.constants if hasattr(src, "constants") else dict()
         cst_key = lambda i: src.fn.arg_names.index(i) if isinstance(i, str) else i
-        constants = {cst_key(key): value for key, value in constants.items()}
         signature = {cst_key(key): value for key, value in src.signature.items()}
-        launcher_src = _generate_launcher(constants, signature, kernel_placeholder_name)
-        # Later KERNEL_NAME_PLACEHOLDER will be used to assign the kernel name
-        # in the following launch function.
-        self.launch = compile_module(launcher_src, kernel_placeholder_name)
-
-    def __call__(self, *args, **kwargs):
-        self.launch(*args, **kwargs)
-
+        self.signature = _signature_descriptor(signature)
+        self.grid_as_loop = getattr(metadata, "grid_as_loop", False)
+
+    def __call__(self, gridX, gridY, gridZ, stream, function,
+                 kernel_metadata, launch_metadata,
+                 launch_enter_hook, launch_exit_hook, *args):
+        # [CPULauncher-specific]: kernel_metadata isn't needed on the CPU, the
+        # kernel is fully described by the function pointer and the signature.
+        graph = capturing_graph()
+        if graph is not None:
+            graph.add_launch(function, self.signature, gridX, gridY, gridZ, args,
+                             grid_as_loop=self.grid_as_loop)
+            return
+        if launch_enter_hook is not None:
+            launch_enter_hook(launch_metadata)
+        triton_shared.runtime.launch(function, self.signature, gridX, gridY, gridZ, args,
+                                     grid_as_loop=self.grid_as_loop, stream=stream)
+        # As on the GPU backends, the exit hook runs once the launch returns:
+        # for a launch on a stream, when the kernel is enqueued, which may be
+        # before it has run.
+        if launch_exit_hook is not None:
+            launch_exit_hook(launch_metadata)
 
 
 class CPUUtils(object):
+    # Kernels may be loaded and launched from several Python threads.
+    _lock = threading.Lock()
+
     def __new__(cls):
-        if not hasattr(cls, "instance"):
-            cls.instance = super(CPUUtils, cls).__new__(cls)
+        with cls._lock:
+            if not hasattr(cls, "instance"):
+                cls.instance = super(CPUUtils, cls).__new__(cls)
         return cls.instance
 
     # Note:
@@ -311,30 +100,34 @@ class CPUUtils(object):
     # (see third_party/nvidia/backend/driver.c)
     # These methods are then used in compiler.py to initialize handles before running
     # the triton kernels.
-    # Since we recompile the kernel every time (see compile_module above),
-    # and the metadata generated by these functions aren't applicable to the cpu
-    # backend, just define the same functions with dummy implementation.
+    # On the CPU, a "multiprocessor" is a thread of the runtime executing the
+    # grid, so persistent kernels that launch one program per multiprocessor
+    # keep every thread busy. The per-core L2 cache stands in for shared
+    # memory. The topology of the host is reported as well, see
+    # backend/include/Runtime/Topology.h; cache sizes are in bytes, 0 if
+    # unknown, and the SIMD width is in bits.
     @staticmethod
     def get_device_properties(device):
+        cpu = triton_shared.runtime.get_cpu_properties()
         return {
-          "max_shared_mem": 2 ** 20,
-          "multiprocessor_count": None,
+          "max_shared_mem": cpu["l2_cache_size"] or 2 ** 20,
+          "multiprocessor_count": cpu["num_threads"],
           "sm_clock_rate": None,
           "mem_clock_rate": None,
-          "mem_bus_width": None
+          "mem_bus_width": None,
+          **cpu,
         }
 
-    # Important note:
-    # Since we cannot easy pass function pointers around, we pass along the
-    # assembly source code so that compile_module above can recompile the
-    # module every time.
+    # The kernel object is linked into the process by the runtime in the
+    # triton_shared plugin, which returns the address of its packed entry point
+    # (see _add_packed_entry in compiler.py).
     @staticmethod
-    def load_binary(name, kernel_asm, shared, device):
+    def load_binary(name, kernel_obj, shared, device):
         return (
-          None,       # module
-          kernel_asm, # function
-          None,       # n_regs
-          None        # n_spills
+          None,                                                          # module
+          triton_shared.runtime.load_kernel(kernel_obj, f"_mlir_{name}"), # function
+          None,                                                          # n_regs
+          None                                                           # n_spills
         )
 
 
@@ -359,8 +152,11 @@ class CPUDriver(DriverBase):
     def get_device_capability(self):
         return ("cpu", 0)
 
+    # Launches are synchronous unless a stream is set with
+    # triton.backends.triton_shared.stream.stream(), None is the synchronous
+    # stream of the launcher. The launcher takes the Stream object itself.
     def get_current_stream(self, device):
-        return None
+        return current_stream()
 
     def get_current_device(self):
         # CPU doesn't have a device to return. Return something.
@@ -0,0 +1,35 @@
+import threading
+from contextlib import contextmanager
+
+from triton._C.libtriton import triton_shared
+
+# A recorded sequence of launches, see backend/include/Runtime/LaunchGraph.h.
+Graph = triton_shared.runtime.Graph
+
+_current = threading.local()
+
+
+def capturing_graph():
+    """Returns the graph the calling thread records launches into, or None."""
+    return getattr(_current, "graph", None)
+
+
+@contextmanager
+def capture(graph=None):
+    """Records the kernel launches of the enclosed block into a graph instead
+    of running them.
+
+    The grids and arguments are resolved at capture time, so `graph.replay()`
+    runs the same launches on the same buffers without going back through the
+    Python launcher. `graph.replay(stream=s)` enqueues the replay on a
+    stream of triton.backends.triton_shared.stream. Kernels are compiled during
+    capture if needed; autotuned kernels should be tuned before capturing, or
+    their benchmark launches get recorded as well.
+    """
+    graph = Graph() if graph is None else graph
+    previous = capturing_graph()
+    _current.graph = graph
+    try:
+        yield graph
+    finally:
+        _current.graph = previous
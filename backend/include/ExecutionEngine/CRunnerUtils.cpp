@@ -14,6 +14,9 @@
 
 #include "CRunnerUtils.h"
 #include "Msan.h"
+#include "Runtime/GridExecutor.h"
+#include "Runtime/Matmul.h"
+#include "Runtime/Memory.h"
 
 #ifndef _WIN32
 #if defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || \
@@ -58,6 +61,141 @@ extern "C" void printClose() { fputs(" )", stdout); }
 extern "C" void printComma() { fputs(", ", stdout); }
 extern "C" void printNewline() { fputc('\n', stdout); }
 
+namespace {
+// Copies of at least this many bytes are split across the grid executor. From
+// inside a program of a multi-program launch they still run serially, but a
+// single program loading a huge block gets the whole pool.
+constexpr int64_t kParallelCopyThreshold = 4 << 20;
+
+template <typename T>
+void copyStridedRow(char *dst, const char *src, int64_t size,
+                    int64_t dstStride, int64_t srcStride) {
+  for (int64_t i = 0; i < size; ++i) {
+    T value;
+    memcpy(&value, src + i * srcStride, sizeof(T));
+    memcpy(dst + i * dstStride, &value, sizeof(T));
+  }
+}
+
+// Copies `size` elements along one dimension. Strides are in bytes.
+void copyRow(char *dst, const char *src, int64_t size, int64_t elemSize,
+             int64_t dstStride, int64_t srcStride) {
+  if (dstStride == elemSize && srcStride == elemSize) {
+    memcpy(dst, src, size * elemSize);
+    return;
+  }
+  switch (elemSize) {
+  case 1:
+    return copyStridedRow<uint8_t>(dst, src, size, dstStride, srcStride);
+  case 2:
+    return copyStridedRow<uint16_t>(dst, src, size, dstStride, srcStride);
+  case 4:
+    return copyStridedRow<uint32_t>(dst, src, size, dstStride, srcStride);
+  case 8:
+    return copyStridedRow<uint64_t>(dst, src, size, dstStride, srcStride);
+  }
+  for (int64_t i = 0; i < size; ++i)
+    memcpy(dst + i * dstStride, src + i * srcStride, elemSize);
+}
+
+// A copy over `rank` dimensions, outermost first, with unit dimensions dropped
+// and dimensions contiguous with their inner neighbour in both source and
+// destination merged into it. Strides are in bytes. A row is one run of the
+// innermost dimension.
+struct CopyShape {
+  int rank;
+  int64_t *sizes;
+  int64_t *srcStrides;
+  int64_t *dstStrides;
+
+  int64_t getNumRows() const {
+    int64_t numRows = 1;
+    for (int axis = 0; axis < rank - 1; ++axis)
+      numRows *= sizes[axis];
+    return numRows;
+  }
+
+  // Byte offsets of the start of row `row` in the source and destination.
+  void getRowOffsets(int64_t row, int64_t &readIndex,
+                     int64_t &writeIndex) const {
+    readIndex = writeIndex = 0;
+    for (int axis = rank - 2; axis >= 0; --axis) {
+      int64_t index = row % sizes[axis];
+      row /= sizes[axis];
+      readIndex += index * srcStrides[axis];
+      writeIndex += index * dstStrides[axis];
+    }
+  }
+};
+
+// Copies rows [begin, end) of `shape`.
+void copyRows(char *dstPtr, const char *srcPtr, int64_t elemSize,
+              const CopyShape &shape, int64_t begin, int64_t end) {
+  int innerAxis = shape.rank - 1;
+  int64_t *indices =
+      static_cast<int64_t *>(alloca(sizeof(int64_t) * shape.rank));
+  int64_t readIndex, writeIndex;
+  shape.getRowOffsets(begin, readIndex, writeIndex);
+  for (int64_t axis = innerAxis - 1, row = begin; axis >= 0; --axis) {
+    indices[axis] = row % shape.sizes[axis];
+    row /= shape.sizes[axis];
+  }
+
+  for (int64_t row = begin; row < end; ++row) {
+    copyRow(dstPtr + writeIndex, srcPtr + readIndex, shape.sizes[innerAxis],
+            elemSize, shape.dstStrides[innerAxis],
+            shape.srcStrides[innerAxis]);
+    // Advance to the next row, as an odometer over the outer dimensions.
+    for (int axis = innerAxis - 1; axis >= 0; --axis) {
+      readIndex += shape.srcStrides[axis];
+      writeIndex += shape.dstStrides[axis];
+      if (++indices[axis] != shape.sizes[axis])
+        break;
+      indices[axis] = 0;
+      readIndex -= shape.sizes[axis] * shape.srcStrides[axis];
+      writeIndex -= shape.sizes[axis] * shape.dstStrides[axis];
+    }
+  }
+}
+
+// Splits a large copy into pieces run by the grid executor. When there are
+// fewer rows than threads, every row is also cut into segments.
+void copyParallel(char *dstPtr, const char *srcPtr, int64_t elemSize,
+                  const CopyShape &shape, int64_t numRows) {
+  int innerAxis = shape.rank - 1;
+  int64_t rowSize = shape.sizes[innerAxis];
+  int64_t numThreads = triton_shared::GridExecutor::get().getNumThreads();
+  int64_t numSegments =
+      numRows >= numThreads
+          ? 1
+          : std::min(rowSize, (numThreads + numRows - 1) / numRows);
+  int64_t segmentSize = (rowSize + numSegments - 1) / numSegments;
+  if (numSegments == 1) {
+    triton_shared::GridExecutor::get().parallelFor(
+        numRows, [&](int64_t begin, int64_t end) {
+          copyRows(dstPtr, srcPtr, elemSize, shape, begin, end);
+        });
+    return;
+  }
+
+  triton_shared::GridExecutor::get().parallelFor(
+      numRows * numSegments, [&](int64_t begin, int64_t end) {
+        for (int64_t item = begin; item < end; ++item) {
+          int64_t first = item % numSegments * segmentSize;
+          int64_t size = std::min(segmentSize, rowSize - first);
+          if (size <= 0)
+            continue;
+          int64_t readIndex, writeIndex;
+          shape.getRowOffsets(item / numSegments, readIndex, writeIndex);
+          readIndex += first * shape.srcStrides[innerAxis];
+          writeIndex += first * shape.dstStrides[innerAxis];
+          copyRow(dstPtr + writeIndex, srcPtr + readIndex, size, elemSize,
+                  shape.dstStrides[innerAxis], shape.srcStrides[innerAxis]);
+        }
+      });
+}
+} // namespace
+
 extern "C" void memrefCopy(int64_t elemSize, UnrankedMemRefType<char> *srcArg,
                            UnrankedMemRefType<char> *dstArg) {
   DynamicMemRefType<char> src(*srcArg);
@@ -74,45 +212,54 @@ extern "C" void memrefCopy(int64_t elemSize, UnrankedMemRefType<char> *srcArg,
   char *srcPtr = src.data + src.offset * elemSize;
   char *dstPtr = dst.data + dst.offset * elemSize;
 
-  if (rank == 0) {
+  // Collect the dimensions from the innermost outwards, dropping unit
+  // dimensions and merging a dimension into its inner neighbour when it steps
+  // over exactly that neighbour in both memrefs.
+  CopyShape shape;
+  shape.rank = 0;
+  shape.sizes = static_cast<int64_t *>(alloca(sizeof(int64_t) * (rank + 1)));
+  shape.srcStrides =
+      static_cast<int64_t *>(alloca(sizeof(int64_t) * (rank + 1)));
+  shape.dstStrides =
+      static_cast<int64_t *>(alloca(sizeof(int64_t) * (rank + 1)));
+  int64_t numElements = 1;
+  for (int64_t axis = rank - 1; axis >= 0; --axis) {
+    int64_t size = src.sizes[axis];
+    int64_t srcStride = src.strides[axis] * elemSize;
+    int64_t dstStride = dst.strides[axis] * elemSize;
+    numElements *= size;
+    if (size == 1)
+      continue;
+    int last = shape.rank - 1;
+    if (last >= 0 &&
+        srcStride == shape.sizes[last] * shape.srcStrides[last] &&
+        dstStride == shape.sizes[last] * shape.dstStrides[last]) {
+      shape.sizes[last] *= size;
+      continue;
+    }
+    shape.sizes[shape.rank] = size;
+    shape.srcStrides[shape.rank] = srcStride;
+    shape.dstStrides[shape.rank] = dstStride;
+    ++shape.rank;
+  }
+
+  // A single element, e.g. a rank-0 memref.
+  if (shape.rank == 0) {
     memcpy(dstPtr, srcPtr, elemSize);
     return;
   }
 
-  int64_t *indices = static_cast<int64_t *>(alloca(sizeof(int64_t) * rank));
-  int64_t *srcStrides = static_cast<int64_t *>(alloca(sizeof(int64_t) * rank));
-  int64_t *dstStrides = static_cast<int64_t *>(alloca(sizeof(int64_t) * rank));
-
-  // Initialize index and scale strides.
-  for (int rankp = 0; rankp < rank; ++rankp) {
-    indices[rankp] = 0;
-    srcStrides[rankp] = src.strides[rankp] * elemSize;
-    dstStrides[rankp] = dst.strides[rankp] * elemSize;
-  }
+  // Put the outermost dimension first.
+  std::reverse(shape.sizes, shape.sizes + shape.rank);
+  std::reverse(shape.srcStrides, shape.srcStrides + shape.rank);
+  std::reverse(shape.dstStrides, shape.dstStrides + shape.rank);
 
-  int64_t readIndex = 0, writeIndex = 0;
-  for (;;) {
-    // Copy over the element, byte by byte.
-    memcpy(dstPtr + writeIndex, srcPtr + readIndex, elemSize);
-    // Advance index and read position.
-    for (int64_t axis = rank - 1; axis >= 0; --axis) {
-      // Advance at current axis.
-      auto newIndex = ++indices[axis];
-      readIndex += srcStrides[axis];
-      writeIndex += dstStrides[axis];
-      // If this is a valid index, we have our next index, so continue copying.
-      if (src.sizes[axis] != newIndex)
-        break;
-      // We reached the end of this axis. If this is axis 0, we are done.
-      if (axis == 0)
-        return;
-      // Else, reset to 0 and undo the advancement of the linear index that
-      // this axis had. Then continue with the axis one outer.
-      indices[axis] = 0;
-      readIndex -= src.sizes[axis] * srcStrides[axis];
-      writeIndex -= dst.sizes[axis] * dstStrides[axis];
-    }
+  int64_t numRows = shape.getNumRows();
+  if (numElements * elemSize >= kParallelCopyThreshold) {
+    copyParallel(dstPtr, srcPtr, elemSize, shape, numRows);
+    return;
   }
+  copyRows(dstPtr, srcPtr, elemSize, shape, 0, numRows);
 }
 
 /// Prints GFLOPS rating.
@@ -134,29 +281,51 @@ extern "C" double rtclock() {
 #endif // _WIN32
 }
 
-extern "C" void *mlirAlloc(uint64_t size) { return malloc(size); }
+// Kernels allocate through these entry points, see Runtime/Memory.h. The
+// generic free function of the MemRef to LLVM conversion does not tell aligned
+// from unaligned allocations apart, so outside of Windows mlirFree and
+// mlirAlignedFree are interchangeable.
+extern "C" void *mlirAlloc(uint64_t size) {
+#ifdef _WIN32
+  return malloc(size);
+#else
+  return triton_shared::allocateMemory(size, 0);
+#endif
+}
 
 extern "C" void *mlirAlignedAlloc(uint64_t alignment, uint64_t size) {
 #ifdef _WIN32
   return _aligned_malloc(size, alignment);
-#elif defined(__APPLE__)
-  // aligned_alloc was added in MacOS 10.15. Fall back to posix_memalign to also
-  // support older versions.
-  void *result = nullptr;
-  (void)::posix_memalign(&result, alignment, size);
-  return result;
 #else
-  return aligned_alloc(alignment, size);
+  return triton_shared::allocateMemory(size, alignment);
 #endif
 }
 
-extern "C" void mlirFree(void *ptr) { free(ptr); }
+extern "C" void mlirFree(void *ptr) {
+#ifdef _WIN32
+  free(ptr);
+#else
+  triton_shared::freeMemory(ptr);
+#endif
+}
 
 extern "C" void mlirAlignedFree(void *ptr) {
 #ifdef _WIN32
   _aligned_free(ptr);
 #else
-  free(ptr);
+  triton_shared::freeMemory(ptr);
+#endif
+}
+
+extern "C" void triton_shared_begin_program() {
+#ifndef _WIN32
+  triton_shared::beginProgram();
+#endif
+}
+
+extern "C" void triton_shared_end_program() {
+#ifndef _WIN32
+  triton_shared::endProgram();
 #endif
 }
 
@@ -189,4 +358,22 @@ IMPL_STDSORT(F64, double)
 IMPL_STDSORT(F32, float)
 #undef IMPL_STDSORT
 
+// C += A * B for the linalg.matmul ops of kernels, see
+// triton-shared-matmul-to-library.
+#define IMPL_MATMUL(VNAME, V, TYPE)                                            \
+  extern "C" void _mlir_ciface_triton_shared_matmul_##VNAME(                   \
+      StridedMemRefType<V, 2> *a, StridedMemRefType<V, 2> *b,                  \
+      StridedMemRefType<float, 2> *c) {                                        \
+    assert(a && b && c);                                                       \
+    triton_shared::matmul(                                                     \
+        triton_shared::MatmulInputType::TYPE, a->sizes[0], b->sizes[1],        \
+        a->sizes[1], {a->data + a->offset, a->strides[0], a->strides[1]},      \
+        {b->data + b->offset, b->strides[0], b->strides[1]},                   \
+        {c->data + c->offset, c->strides[0], c->strides[1]});                  \
+  }
+IMPL_MATMUL(f32, float, F32)
+IMPL_MATMUL(f16_f32, uint16_t, F16)
+IMPL_MATMUL(bf16_f32, uint16_t, BF16)
+#undef IMPL_MATMUL
+
 #endif // MLIR_CRUNNERUTILS_DEFINE_FUNCTIONS
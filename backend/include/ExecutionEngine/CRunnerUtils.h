@@ -477,6 +477,19 @@ extern "C" MLIR_CRUNNERUTILS_EXPORT void printNewline();
 extern "C" MLIR_CRUNNERUTILS_EXPORT void printFlops(double flops);
 extern "C" MLIR_CRUNNERUTILS_EXPORT double rtclock();
 
+//===----------------------------------------------------------------------===//
+// Small runtime support library for memref allocation.
+//===----------------------------------------------------------------------===//
+extern "C" MLIR_CRUNNERUTILS_EXPORT void *mlirAlloc(uint64_t size);
+extern "C" MLIR_CRUNNERUTILS_EXPORT void *mlirAlignedAlloc(uint64_t alignment,
+                                                           uint64_t size);
+extern "C" MLIR_CRUNNERUTILS_EXPORT void mlirFree(void *ptr);
+extern "C" MLIR_CRUNNERUTILS_EXPORT void mlirAlignedFree(void *ptr);
+// Bracket one program of a kernel lowered with the grid as a loop, whose
+// buffers are released at the end of the program.
+extern "C" MLIR_CRUNNERUTILS_EXPORT void triton_shared_begin_program();
+extern "C" MLIR_CRUNNERUTILS_EXPORT void triton_shared_end_program();
+
 //===----------------------------------------------------------------------===//
 // Runtime support library for random number generation.
 //===----------------------------------------------------------------------===//
@@ -496,4 +509,22 @@ extern "C" MLIR_CRUNNERUTILS_EXPORT void
 _mlir_ciface_stdSortF64(uint64_t n, StridedMemRefType<double, 1> *vref);
 extern "C" MLIR_CRUNNERUTILS_EXPORT void
 _mlir_ciface_stdSortF32(uint64_t n, StridedMemRefType<float, 1> *vref);
+
+//===----------------------------------------------------------------------===//
+// Packed matrix multiplication, C += A * B, for kernels lowered with
+// triton-shared-matmul-to-library. f16 and bf16 operands are passed as their
+// bits.
+//===----------------------------------------------------------------------===//
+extern "C" MLIR_CRUNNERUTILS_EXPORT void
+_mlir_ciface_triton_shared_matmul_f32(StridedMemRefType<float, 2> *a,
+                                      StridedMemRefType<float, 2> *b,
+                                      StridedMemRefType<float, 2> *c);
+extern "C" MLIR_CRUNNERUTILS_EXPORT void
+_mlir_ciface_triton_shared_matmul_f16_f32(StridedMemRefType<uint16_t, 2> *a,
+                                          StridedMemRefType<uint16_t, 2> *b,
+                                          StridedMemRefType<float, 2> *c);
+extern "C" MLIR_CRUNNERUTILS_EXPORT void
+_mlir_ciface_triton_shared_matmul_bf16_f32(StridedMemRefType<uint16_t, 2> *a,
+                                           StridedMemRefType<uint16_t, 2> *b,
+                                           StridedMemRefType<float, 2> *c);
 #endif // MLIR_EXECUTIONENGINE_CRUNNERUTILS_H
@@ -0,0 +1,253 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+
+#include "GridExecutor.h"
+#include "Topology.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace triton_shared {
+
+namespace {
+
+// Set on pool threads and on a caller while it runs its share of a launch.
+// Nested launches from such threads run serially instead of deadlocking on the
+// pool.
+thread_local bool insideLaunch = false;
+
+// Each worker starts with numItems / numThreads programs and pops them in
+// chunks of `grain`; keeping several chunks per worker leaves room for
+// stealing to even out the load.
+constexpr int64_t kChunksPerThread = 16;
+
+unsigned getDefaultNumThreads() {
+  if (const char *env = std::getenv("TRITON_SHARED_NUM_THREADS")) {
+    long value = std::strtol(env, nullptr, 10);
+    if (value > 0)
+      return static_cast<unsigned>(value);
+  }
+  return getCPUTopology().getNumCPUs();
+}
+
+bool shouldPinThreads() {
+  const char *env = std::getenv("TRITON_SHARED_PIN_THREADS");
+  return env && std::strcmp(env, "1") == 0;
+}
+
+void pinCurrentThread(int cpu) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  // Best effort: an unpinned worker still runs correctly.
+  (void)pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+  (void)cpu;
+#endif
+}
+
+} // namespace
+
+GridExecutor &GridExecutor::get() {
+  // Intentionally leaked: the workers may still be parked when static
+  // destructors run at interpreter exit.
+  static GridExecutor *executor = new GridExecutor(getDefaultNumThreads());
+  return *executor;
+}
+
+GridExecutor::GridExecutor(unsigned numThreads)
+    : numThreads(std::max(1u, numThreads)), workerNode(this->numThreads, 0), workerCPU(this->numThreads, -1) {
+  // Give every node a contiguous block of workers. Worker i of a node takes
+  // the i-th CPU of the node, wrapping around when there are more workers
+  // than CPUs.
+  const CPUTopology &topology = getCPUTopology();
+  unsigned numNodes = topology.nodes.size();
+  bool pin = shouldPinThreads();
+  unsigned firstOfNode = 0;
+  for (unsigned id = 0; id < this->numThreads; ++id) {
+    unsigned node = static_cast<uint64_t>(id) * numNodes / this->numThreads;
+    if (id == 0 || node != workerNode[id - 1])
+      firstOfNode = id;
+    workerNode[id] = node;
+    const std::vector<unsigned> &cpus = topology.nodes[node].cpus;
+    if (pin && id != 0)
+      workerCPU[id] = cpus[(id - firstOfNode) % cpus.size()];
+  }
+
+  // Worker 0 is whichever thread calls parallelFor.
+  workers.reserve(this->numThreads - 1);
+  for (unsigned id = 1; id < this->numThreads; ++id)
+    workers.emplace_back([this, id] { workerLoop(id); });
+}
+
+GridExecutor::~GridExecutor() {
+  {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    shuttingDown = true;
+  }
+  wakeCv.notify_all();
+  for (auto &worker : workers)
+    worker.join();
+}
+
+GridExecutor::Launch::Launch(const RangeFn &fn, int64_t numItems,
+                             unsigned numThreads, int64_t maxGrain)
+    : fn(fn), grain(std::clamp<int64_t>(
+                  numItems / (numThreads * kChunksPerThread), 1, maxGrain)),
+      ranges(new WorkRange[numThreads]), remaining(numItems) {
+  for (unsigned id = 0; id < numThreads; ++id) {
+    ranges[id].begin = numItems * id / numThreads;
+    ranges[id].end = numItems * (id + 1) / numThreads;
+  }
+}
+
+void GridExecutor::parallelFor(int64_t numItems, const RangeFn &fn,
+                               int64_t maxGrain) {
+  if (numItems <= 0)
+    return;
+  if (numThreads == 1 || numItems == 1 || insideLaunch) {
+    for (int64_t begin = 0; begin < numItems; begin += maxGrain)
+      fn(begin, begin + std::min(maxGrain, numItems - begin));
+    return;
+  }
+
+  // A launch from another thread, e.g. an independent request of a serving
+  // process, gets its own ranges; idle workers split themselves between the
+  // launches in flight.
+  Launch launch(fn, numItems, numThreads, maxGrain);
+  {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    launches.push_back(&launch);
+  }
+  wakeCv.notify_all();
+
+  insideLaunch = true;
+  work(launch, 0);
+  insideLaunch = false;
+
+  std::unique_lock<std::mutex> lock(poolMutex);
+  retire(launch);
+  doneCv.wait(lock, [&] {
+    return launch.remaining.load(std::memory_order_acquire) == 0 &&
+           launch.numWorkers == 0;
+  });
+}
+
+bool GridExecutor::popLocal(Launch &launch, unsigned id, int64_t &begin,
+                            int64_t &end) {
+  WorkRange &range = launch.ranges[id];
+  std::lock_guard<std::mutex> lock(range.mutex);
+  if (range.begin >= range.end)
+    return false;
+  begin = range.begin;
+  end = std::min(range.end, begin + launch.grain);
+  range.begin = end;
+  return true;
+}
+
+bool GridExecutor::stealFrom(Launch &launch, unsigned id, unsigned victimId) {
+  WorkRange &victim = launch.ranges[victimId];
+  int64_t stolenBegin, stolenEnd;
+  {
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    int64_t available = victim.end - victim.begin;
+    if (available <= 0)
+      return false;
+    // Take the back half so the victim keeps walking its range in order.
+    stolenEnd = victim.end;
+    stolenBegin = victim.end - std::max<int64_t>(1, available / 2);
+    victim.end = stolenBegin;
+  }
+  {
+    std::lock_guard<std::mutex> lock(launch.ranges[id].mutex);
+    launch.ranges[id].begin = stolenBegin;
+    launch.ranges[id].end = stolenEnd;
+  }
+  return true;
+}
+
+bool GridExecutor::steal(Launch &launch, unsigned id, int64_t &begin,
+                         int64_t &end) {
+  for (;;) {
+    bool foundWork = false;
+    // Prefer victims of the same NUMA node, whose part of the grid is more
+    // likely to touch memory local to this worker.
+    for (bool sameNode : {true, false}) {
+      for (unsigned k = 1; k < numThreads; ++k) {
+        unsigned victim = (id + k) % numThreads;
+        if ((workerNode[victim] == workerNode[id]) != sameNode)
+          continue;
+        if (!stealFrom(launch, id, victim))
+          continue;
+        foundWork = true;
+        // Another thief may already have taken the range we just installed.
+        if (popLocal(launch, id, begin, end))
+          return true;
+      }
+    }
+    if (!foundWork)
+      return false;
+  }
+}
+
+void GridExecutor::work(Launch &launch, unsigned id) {
+  int64_t begin, end;
+  while (popLocal(launch, id, begin, end) || steal(launch, id, begin, end)) {
+    launch.fn(begin, end);
+    int64_t count = end - begin;
+    if (launch.remaining.fetch_sub(count, std::memory_order_acq_rel) ==
+        count) {
+      // Last chunk of the launch: wake up the caller.
+      std::lock_guard<std::mutex> lock(poolMutex);
+      doneCv.notify_all();
+    }
+  }
+}
+
+void GridExecutor::retire(Launch &launch) {
+  auto it = std::find(launches.begin(), launches.end(), &launch);
+  if (it != launches.end())
+    launches.erase(it);
+}
+
+void GridExecutor::workerLoop(unsigned id) {
+  if (workerCPU[id] >= 0)
+    pinCurrentThread(workerCPU[id]);
+  insideLaunch = true;
+  for (;;) {
+    Launch *launch;
+    {
+      std::unique_lock<std::mutex> lock(poolMutex);
+      wakeCv.wait(lock, [this] { return shuttingDown || !launches.empty(); });
+      if (shuttingDown)
+        return;
+      launch = *std::min_element(launches.begin(), launches.end(),
+                                 [](const Launch *a, const Launch *b) {
+                                   return a->numWorkers < b->numWorkers;
+                                 });
+      ++launch->numWorkers;
+    }
+    work(*launch, id);
+    {
+      // The launch has no programs left to hand out; keep idle workers from
+      // joining it again. Its owner may return as soon as the count drops.
+      std::lock_guard<std::mutex> lock(poolMutex);
+      retire(*launch);
+      if (--launch->numWorkers == 0)
+        doneCv.notify_all();
+    }
+  }
+}
+
+} // namespace triton_shared
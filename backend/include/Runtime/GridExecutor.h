@@ -0,0 +1,129 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+//
+// A persistent thread pool that runs the programs of a Triton launch grid in
+// parallel. Every launch splits the linearized (x, y, z) program ids evenly
+// across the workers; a worker that runs out of programs steals half of the
+// remaining range of another worker, so uneven program costs still keep all
+// cores busy.
+//
+// Every launch has its own ranges, so launches from several threads share the
+// pool: an idle worker joins the launch in flight with the fewest workers, and
+// each caller keeps working on its own grid until it completes.
+//
+// The number of workers defaults to the number of CPUs the process may run on
+// and can be overridden with the TRITON_SHARED_NUM_THREADS environment
+// variable.
+//
+// Workers are spread over the NUMA nodes of the host in contiguous blocks, so
+// each node runs a contiguous part of the grid, and steal from workers of
+// their own node first. With TRITON_SHARED_PIN_THREADS=1, every worker but the
+// calling thread is pinned to a CPU of its node.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TRITON_SHARED_RUNTIME_GRIDEXECUTOR_H
+#define TRITON_SHARED_RUNTIME_GRIDEXECUTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace triton_shared {
+
+class GridExecutor {
+public:
+  /// Callback that runs the half-open range [begin, end) of linearized
+  /// program ids.
+  using RangeFn = std::function<void(int64_t begin, int64_t end)>;
+
+  /// Returns the process-wide executor. The worker threads are created on the
+  /// first call.
+  static GridExecutor &get();
+
+  explicit GridExecutor(unsigned numThreads);
+  ~GridExecutor();
+
+  GridExecutor(const GridExecutor &) = delete;
+  GridExecutor &operator=(const GridExecutor &) = delete;
+
+  /// Number of threads taking part in a launch, including the caller.
+  unsigned getNumThreads() const { return numThreads; }
+
+  /// Runs `fn` over [0, numItems) split into chunks of at most `maxGrain`
+  /// items, returning once every chunk has completed. The calling thread
+  /// participates in the work. Calls made from inside a worker run serially on
+  /// the calling thread. Safe to call from several threads at once.
+  void parallelFor(int64_t numItems, const RangeFn &fn,
+                   int64_t maxGrain = std::numeric_limits<int64_t>::max());
+
+  /// Maps a linearized program id back to its (x, y, z) coordinates. Program
+  /// ids are linearized with z varying fastest.
+  static void delinearize(int64_t id, int gridY, int gridZ, int32_t &x,
+                          int32_t &y, int32_t &z) {
+    z = static_cast<int32_t>(id % gridZ);
+    int64_t xy = id / gridZ;
+    y = static_cast<int32_t>(xy % gridY);
+    x = static_cast<int32_t>(xy / gridY);
+  }
+
+private:
+  // The part of a launch owned by one worker. Aligned to avoid false sharing
+  // between the per-worker locks.
+  struct alignas(64) WorkRange {
+    std::mutex mutex;
+    int64_t begin = 0;
+    int64_t end = 0;
+  };
+
+  // A grid in flight, owned by the thread that launched it. Range 0 belongs to
+  // that thread and range i to pool worker i.
+  struct Launch {
+    Launch(const RangeFn &fn, int64_t numItems, unsigned numThreads,
+           int64_t maxGrain);
+
+    const RangeFn &fn;
+    int64_t grain;
+    std::unique_ptr<WorkRange[]> ranges;
+    std::atomic<int64_t> remaining;
+    // Pool workers inside work() for this launch. Protected by poolMutex; the
+    // owner returns, destroying the launch, only once it drops to zero.
+    unsigned numWorkers = 0;
+  };
+
+  bool popLocal(Launch &launch, unsigned id, int64_t &begin, int64_t &end);
+  bool stealFrom(Launch &launch, unsigned id, unsigned victim);
+  bool steal(Launch &launch, unsigned id, int64_t &begin, int64_t &end);
+  void work(Launch &launch, unsigned id);
+  void retire(Launch &launch);
+  void workerLoop(unsigned id);
+
+  const unsigned numThreads;
+  // NUMA node index of every worker, and the CPU it is pinned to or -1.
+  std::vector<unsigned> workerNode;
+  std::vector<int> workerCPU;
+  std::vector<std::thread> workers;
+
+  // Protects `launches`, `shuttingDown` and the worker counts of the
+  // launches, and pairs with the condition variables below.
+  std::mutex poolMutex;
+  std::condition_variable wakeCv;
+  std::condition_variable doneCv;
+  // Launches that idle workers may still join.
+  std::vector<Launch *> launches;
+  bool shuttingDown = false;
+};
+
+} // namespace triton_shared
+
+#endif // TRITON_SHARED_RUNTIME_GRIDEXECUTOR_H
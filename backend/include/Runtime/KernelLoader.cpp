@@ -0,0 +1,268 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+
+#include "KernelLoader.h"
+#include "ExecutionEngine/CRunnerUtils.h"
+
+#include "llvm/BinaryFormat/Magic.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/Mangling.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetSelect.h"
+
+#include <string>
+
+using namespace llvm;
+using namespace llvm::orc;
+
+namespace triton_shared {
+
+namespace {
+
+// Entry points of CRunnerUtils.cpp that lowered kernels may reference.
+#define TRITON_SHARED_RUNTIME_SYMBOLS(X)                                       \
+  X(memrefCopy)                                                                \
+  X(mlirAlloc)                                                                 \
+  X(mlirAlignedAlloc)                                                          \
+  X(mlirFree)                                                                  \
+  X(mlirAlignedFree)                                                           \
+  X(triton_shared_begin_program)                                               \
+  X(triton_shared_end_program)                                                 \
+  X(printI64)                                                                  \
+  X(printU64)                                                                  \
+  X(printF32)                                                                  \
+  X(printF64)                                                                  \
+  X(printString)                                                               \
+  X(printOpen)                                                                 \
+  X(printClose)                                                                \
+  X(printComma)                                                                \
+  X(printNewline)                                                              \
+  X(printFlops)                                                                \
+  X(rtclock)                                                                   \
+  X(rtsrand)                                                                   \
+  X(rtrand)                                                                    \
+  X(rtdrand)                                                                   \
+  X(_mlir_ciface_stdSortI64)                                                   \
+  X(_mlir_ciface_stdSortF64)                                                   \
+  X(_mlir_ciface_stdSortF32)                                                   \
+  X(_mlir_ciface_triton_shared_matmul_f32)                                     \
+  X(_mlir_ciface_triton_shared_matmul_f16_f32)                                 \
+  X(_mlir_ciface_triton_shared_matmul_bf16_f32)
+
+// Allocation functions called by kernels lowered with the generic allocation
+// functions of the MemRef to LLVM conversion, and their implementations.
+#define TRITON_SHARED_ALLOCATION_SYMBOLS(X)                                    \
+  X(_mlir_memref_to_llvm_alloc, mlirAlloc)                                     \
+  X(_mlir_memref_to_llvm_aligned_alloc, mlirAlignedAlloc)                      \
+  X(_mlir_memref_to_llvm_free, mlirFree)
+
+SymbolMap getRuntimeSymbols(MangleAndInterner &mangle) {
+  SymbolMap symbols;
+#define ADD_RUNTIME_SYMBOL_ALIAS(NAME, FUNCTION)                               \
+  symbols[mangle(#NAME)] = {ExecutorAddr::fromPtr(&FUNCTION),                  \
+                            JITSymbolFlags::Exported |                         \
+                                JITSymbolFlags::Callable};
+#define ADD_RUNTIME_SYMBOL(NAME) ADD_RUNTIME_SYMBOL_ALIAS(NAME, NAME)
+  TRITON_SHARED_RUNTIME_SYMBOLS(ADD_RUNTIME_SYMBOL)
+  TRITON_SHARED_ALLOCATION_SYMBOLS(ADD_RUNTIME_SYMBOL_ALIAS)
+#undef ADD_RUNTIME_SYMBOL
+#undef ADD_RUNTIME_SYMBOL_ALIAS
+  return symbols;
+}
+
+#undef TRITON_SHARED_RUNTIME_SYMBOLS
+#undef TRITON_SHARED_ALLOCATION_SYMBOLS
+
+constexpr StringLiteral kFatBinaryMagic = "TSFATBIN";
+
+// Reads a little-endian integer of type T at `offset` and advances it.
+template <typename T>
+bool readInteger(StringRef data, size_t &offset, T &value) {
+  if (data.size() - offset < sizeof(T))
+    return false;
+  value = support::endian::read<T, llvm::endianness::little>(
+      data.data() + offset);
+  offset += sizeof(T);
+  return true;
+}
+
+Expected<StringRef> selectFatBinaryVariant(StringRef kernel) {
+  auto malformed = [] {
+    return make_error<StringError>("malformed fat kernel binary",
+                                   inconvertibleErrorCode());
+  };
+
+  size_t offset = kFatBinaryMagic.size();
+  uint32_t count;
+  if (!readInteger(kernel, offset, count))
+    return malformed();
+
+  std::string isas;
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t isaSize;
+    if (!readInteger(kernel, offset, isaSize) ||
+        kernel.size() - offset < isaSize)
+      return malformed();
+    StringRef isa = kernel.substr(offset, isaSize);
+    offset += isaSize;
+
+    uint64_t binarySize;
+    if (!readInteger(kernel, offset, binarySize) ||
+        kernel.size() - offset < binarySize)
+      return malformed();
+    StringRef binary = kernel.substr(offset, binarySize);
+    offset += binarySize;
+
+    if (KernelLoader::isSupportedISA(isa))
+      return binary;
+    isas += (isas.empty() ? "" : ", ") + isa.str();
+  }
+  return make_error<StringError>(
+      "the host CPU supports none of the kernel variants (" + isas + ")",
+      inconvertibleErrorCode());
+}
+
+} // namespace
+
+KernelLoader &KernelLoader::get() {
+  // Intentionally leaked: loaded kernels stay valid until the process exits.
+  static KernelLoader *loader = new KernelLoader();
+  return *loader;
+}
+
+Error KernelLoader::initialize() {
+  if (jit)
+    return Error::success();
+
+  InitializeNativeTarget();
+  InitializeNativeTargetAsmPrinter();
+
+  auto jitOrErr = LLJITBuilder().create();
+  if (!jitOrErr)
+    return jitOrErr.takeError();
+  jit = std::move(*jitOrErr);
+
+  JITDylib &main = jit->getMainJITDylib();
+  MangleAndInterner mangle(jit->getExecutionSession(), jit->getDataLayout());
+  if (Error err = main.define(absoluteSymbols(getRuntimeSymbols(mangle))))
+    return err;
+
+  auto processSymbols = DynamicLibrarySearchGenerator::GetForCurrentProcess(
+      jit->getDataLayout().getGlobalPrefix());
+  if (!processSymbols)
+    return processSymbols.takeError();
+  main.addGenerator(std::move(*processSymbols));
+  return Error::success();
+}
+
+Expected<JITDylib &> KernelLoader::createKernelDylib() {
+  auto dylib = jit->createJITDylib("kernel." + std::to_string(numKernels++));
+  if (!dylib)
+    return dylib.takeError();
+  dylib->addToLinkOrder(jit->getMainJITDylib());
+  return *dylib;
+}
+
+Expected<void *> KernelLoader::loadObject(StringRef object, StringRef symbol) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (Error err = initialize())
+    return std::move(err);
+
+  auto dylib = createKernelDylib();
+  if (!dylib)
+    return dylib.takeError();
+
+  if (Error err = jit->addObjectFile(
+          *dylib, MemoryBuffer::getMemBufferCopy(object, symbol)))
+    return std::move(err);
+
+  auto address = jit->lookup(*dylib, symbol);
+  if (!address)
+    return address.takeError();
+  return address->toPtr<void *>();
+}
+
+Expected<void *> KernelLoader::loadIR(StringRef ir, StringRef symbol) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (Error err = initialize())
+    return std::move(err);
+
+  // The textual IR parser needs a null-terminated buffer.
+  std::unique_ptr<MemoryBuffer> buffer =
+      MemoryBuffer::getMemBufferCopy(ir, symbol);
+  auto context = std::make_unique<LLVMContext>();
+  SMDiagnostic diagnostic;
+  std::unique_ptr<Module> module =
+      parseIR(buffer->getMemBufferRef(), diagnostic, *context);
+  if (!module) {
+    std::string message;
+    raw_string_ostream os(message);
+    diagnostic.print(symbol.str().c_str(), os);
+    return make_error<StringError>(os.str(), inconvertibleErrorCode());
+  }
+
+  auto dylib = createKernelDylib();
+  if (!dylib)
+    return dylib.takeError();
+
+  if (Error err = jit->addIRModule(
+          *dylib, ThreadSafeModule(std::move(module), std::move(context))))
+    return std::move(err);
+
+  auto address = jit->lookup(*dylib, symbol);
+  if (!address)
+    return address.takeError();
+  return address->toPtr<void *>();
+}
+
+bool KernelLoader::isSupportedISA(StringRef isa) {
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+  __builtin_cpu_init();
+  bool v2 = __builtin_cpu_supports("sse4.2") &&
+            __builtin_cpu_supports("popcnt") &&
+            __builtin_cpu_supports("ssse3");
+  bool v3 = v2 && __builtin_cpu_supports("avx2") &&
+            __builtin_cpu_supports("fma") && __builtin_cpu_supports("bmi2");
+  bool v4 = v3 && __builtin_cpu_supports("avx512f") &&
+            __builtin_cpu_supports("avx512bw") &&
+            __builtin_cpu_supports("avx512dq") &&
+            __builtin_cpu_supports("avx512vl") &&
+            __builtin_cpu_supports("avx512cd");
+  if (isa == "x86-64-v4")
+    return v4;
+  if (isa == "x86-64-v3")
+    return v3;
+  if (isa == "x86-64-v2")
+    return v2;
+  if (isa == "x86-64")
+    return true;
+#endif
+  return isa == "generic";
+}
+
+Expected<void *> KernelLoader::loadKernel(StringRef kernel, StringRef symbol) {
+  if (kernel.starts_with(kFatBinaryMagic)) {
+    auto variant = selectFatBinaryVariant(kernel);
+    if (!variant)
+      return variant.takeError();
+    return loadKernel(*variant, symbol);
+  }
+
+  switch (identify_magic(kernel)) {
+  case file_magic::elf_relocatable:
+  case file_magic::macho_object:
+  case file_magic::coff_object:
+    return loadObject(kernel, symbol);
+  default:
+    return loadIR(kernel, symbol);
+  }
+}
+
+} // namespace triton_shared
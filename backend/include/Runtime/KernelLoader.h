@@ -0,0 +1,77 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+//
+// Loads compiled kernels into the running process with LLVM ORC. Kernels come
+// either as relocatable objects produced by llc, or as LLVM IR that is compiled
+// for the host by the JIT itself. Kernel references to the CPU runtime
+// (memrefCopy, mlirAlloc, ...) resolve to the copies linked into this library,
+// everything else (libc, libm) to the symbols of the process.
+//
+// A kernel can also be a fat binary holding one object or IR module per ISA
+// level, most capable first:
+//
+//   "TSFATBIN"                      magic
+//   uint32_t count
+//   count times:
+//     uint32_t isaSize, char isa[isaSize]       e.g. "x86-64-v3"
+//     uint64_t binarySize, char binary[binarySize]
+//
+// with little-endian integers. The loader picks the first variant the host CPU
+// supports.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TRITON_SHARED_RUNTIME_KERNELLOADER_H
+#define TRITON_SHARED_RUNTIME_KERNELLOADER_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/Support/Error.h"
+
+#include <memory>
+#include <mutex>
+
+namespace triton_shared {
+
+class KernelLoader {
+public:
+  /// Returns the process-wide loader.
+  static KernelLoader &get();
+
+  /// Links the relocatable object `object` into the process and returns the
+  /// address of `symbol`. Every object gets its own symbol namespace, so
+  /// specializations of a kernel sharing a name can be loaded side by side.
+  llvm::Expected<void *> loadObject(llvm::StringRef object,
+                                    llvm::StringRef symbol);
+
+  /// Compiles the LLVM IR module `ir`, in textual or bitcode form, for the
+  /// host and returns the address of `symbol`.
+  llvm::Expected<void *> loadIR(llvm::StringRef ir, llvm::StringRef symbol);
+
+  /// Dispatches to loadObject or loadIR depending on the format of `kernel`.
+  /// For fat binaries, loads the best variant for the host CPU.
+  llvm::Expected<void *> loadKernel(llvm::StringRef kernel,
+                                    llvm::StringRef symbol);
+
+  /// Returns true if the host CPU can run code compiled for `isa`, an LLVM
+  /// CPU name such as "x86-64-v3".
+  static bool isSupportedISA(llvm::StringRef isa);
+
+private:
+  KernelLoader() = default;
+
+  llvm::Error initialize();
+  llvm::Expected<llvm::orc::JITDylib &> createKernelDylib();
+
+  std::mutex mutex;
+  std::unique_ptr<llvm::orc::LLJIT> jit;
+  unsigned numKernels = 0;
+};
+
+} // namespace triton_shared
+
+#endif // TRITON_SHARED_RUNTIME_KERNELLOADER_H
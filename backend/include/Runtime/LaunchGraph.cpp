@@ -0,0 +1,31 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+
+#include "LaunchGraph.h"
+
+namespace triton_shared {
+
+void LaunchGraph::addLaunch(PackedKernelFn fn, KernelArguments args,
+                            int gridX, int gridY, int gridZ, bool gridAsLoop) {
+  // Moving the arguments keeps the addresses of their descriptors, which the
+  // packed slots point to.
+  launches.push_back(std::make_shared<const Launch>(
+      Launch{fn, std::move(args), gridX, gridY, gridZ, gridAsLoop}));
+}
+
+void LaunchGraph::replay() const {
+  for (const auto &launch : launches) {
+    if (launch->gridAsLoop)
+      launch->args.launchRange(launch->fn, launch->gridX, launch->gridY,
+                               launch->gridZ);
+    else
+      launch->args.launch(launch->fn, launch->gridX, launch->gridY,
+                          launch->gridZ);
+  }
+}
+
+} // namespace triton_shared
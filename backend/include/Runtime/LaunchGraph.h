@@ -0,0 +1,53 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+//
+// A recorded sequence of kernel launches with their grids and marshaled
+// arguments. Replaying the graph runs the launches in order without going back
+// through Python, so a loop launching the same kernels on the same buffers
+// pays the launch overhead once, at capture time.
+//
+// Copies of a graph share the recorded launches, so a copy is a cheap snapshot
+// that launches added to the original later are not part of.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TRITON_SHARED_RUNTIME_LAUNCHGRAPH_H
+#define TRITON_SHARED_RUNTIME_LAUNCHGRAPH_H
+
+#include "Launcher.h"
+
+#include <memory>
+#include <vector>
+
+namespace triton_shared {
+
+class LaunchGraph {
+public:
+  /// Appends a launch of `fn` over a gridX x gridY x gridZ grid. `gridAsLoop`
+  /// selects KernelArguments::launchRange over KernelArguments::launch.
+  void addLaunch(PackedKernelFn fn, KernelArguments args, int gridX, int gridY,
+                 int gridZ, bool gridAsLoop);
+
+  size_t size() const { return launches.size(); }
+
+  /// Runs the recorded launches in order, each one after the previous one
+  /// has completed.
+  void replay() const;
+
+private:
+  struct Launch {
+    PackedKernelFn fn;
+    KernelArguments args;
+    int gridX, gridY, gridZ;
+    bool gridAsLoop;
+  };
+  std::vector<std::shared_ptr<const Launch>> launches;
+};
+
+} // namespace triton_shared
+
+#endif // TRITON_SHARED_RUNTIME_LAUNCHGRAPH_H
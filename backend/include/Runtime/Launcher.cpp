@@ -0,0 +1,126 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Launcher.h"
+#include "GridExecutor.h"
+#include "Memory.h"
+
+namespace triton_shared {
+
+bool isValidArgKind(char kind) {
+  switch (kind) {
+  case 'P':
+  case 'O':
+  case 'b':
+  case 'h':
+  case 'i':
+  case 'l':
+  case 'B':
+  case 'H':
+  case 'I':
+  case 'K':
+  case 'f':
+  case 'd':
+    return true;
+  default:
+    return false;
+  }
+}
+
+KernelArguments::KernelArguments(std::string signature)
+    : signature(std::move(signature)) {
+  size_t numSlots = 0;
+  size_t numPointers = 0;
+  slotIndex.reserve(this->signature.size());
+  for (char kind : this->signature) {
+    slotIndex.push_back(numSlots);
+    if (kind == 'P') {
+      // Unranked memref: rank followed by the descriptor address.
+      numSlots += 2;
+      ++numPointers;
+    } else if (kind != 'O') {
+      numSlots += 1;
+    }
+  }
+
+  slots.assign(numSlots, 0);
+  descriptors.resize(numPointers);
+  size_t descriptor = 0;
+  for (size_t i = 0; i < this->signature.size(); ++i) {
+    if (this->signature[i] != 'P')
+      continue;
+    descriptors[descriptor] = {nullptr, nullptr, 0};
+    slots[slotIndex[i] + 1] =
+        reinterpret_cast<uintptr_t>(&descriptors[descriptor]);
+    ++descriptor;
+  }
+}
+
+void KernelArguments::setPointer(size_t index, void *ptr) {
+  auto *descriptor = reinterpret_cast<StridedMemRefType<char, 0> *>(
+      slots[slotIndex[index] + 1]);
+  descriptor->basePtr = static_cast<char *>(ptr);
+  descriptor->data = static_cast<char *>(ptr);
+}
+
+void KernelArguments::launch(PackedKernelFn fn, int gridX, int gridY,
+                             int gridZ) const {
+  int64_t numPrograms = static_cast<int64_t>(gridX) * gridY * gridZ;
+  if (numPrograms <= 0)
+    return;
+
+  GridExecutor::get().parallelFor(numPrograms, [&](int64_t begin,
+                                                   int64_t end) {
+    // The kernel arguments are shared by all programs; only the program ids
+    // differ, so each chunk gets its own copy of the program info.
+    int32_t programInfo[kProgramInfoArgCount] = {gridX, gridY, gridZ, 0, 0, 0};
+    std::vector<void *> args;
+    args.reserve(slots.size() + kProgramInfoArgCount);
+    for (const uint64_t &slot : slots)
+      args.push_back(const_cast<uint64_t *>(&slot));
+    for (int32_t &info : programInfo)
+      args.push_back(&info);
+
+    for (int64_t i = begin; i < end; ++i) {
+      GridExecutor::delinearize(i, gridY, gridZ, programInfo[3],
+                                programInfo[4], programInfo[5]);
+      ProgramScope scope;
+      fn(args.data());
+    }
+  });
+}
+
+// Programs handed to one call of a grid-as-loop kernel. Enough to amortize the
+// call, few enough that idle workers still find ranges to steal.
+constexpr int64_t kMaxProgramsPerRange = 64;
+
+void KernelArguments::launchRange(PackedKernelFn fn, int gridX, int gridY,
+                                  int gridZ) const {
+  int64_t numPrograms = static_cast<int64_t>(gridX) * gridY * gridZ;
+  if (numPrograms <= 0)
+    return;
+
+  GridExecutor::get().parallelFor(numPrograms, [&](int64_t begin,
+                                                   int64_t end) {
+    int32_t grid[3] = {gridX, gridY, gridZ};
+    int64_t range[2] = {begin, end};
+    std::vector<void *> args;
+    args.reserve(slots.size() + kProgramRangeArgCount);
+    for (const uint64_t &slot : slots)
+      args.push_back(const_cast<uint64_t *>(&slot));
+    for (int32_t &size : grid)
+      args.push_back(&size);
+    for (int64_t &bound : range)
+      args.push_back(&bound);
+    // Each program of the range releases its own buffers, see GridToLoop;
+    // the scope catches whatever the range function allocates around them.
+    ProgramScope scope;
+    fn(args.data());
+  }, kMaxProgramsPerRange);
+}
+
+} // namespace triton_shared
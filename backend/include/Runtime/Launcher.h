@@ -0,0 +1,102 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+//
+// Generic launcher for kernels compiled by the CPU backend.
+//
+// Every kernel object carries a packed entry point `_mlir_<kernel>` (see
+// `_add_packed_entry` in compiler.py) that takes an array holding the address
+// of each kernel argument, the same convention as the packed functions of the
+// MLIR ExecutionEngine. This lets a single precompiled launcher call kernels of
+// any signature: the arguments are marshaled according to a compact signature
+// descriptor with one character per Triton kernel argument:
+//
+//   'P'                      pointer, passed as an unranked memref
+//   'O'                      constexpr, not passed to the kernel
+//   'b' 'h' 'i' 'l'          int8_t, int16_t, int32_t, int64_t
+//   'B' 'H' 'I' 'K'          uint8_t, uint16_t, uint32_t, uint64_t
+//   'f' 'd'                  float, double
+//
+// The six i32 grid/program id arguments appended by TritonArithToLinalg are
+// filled in by the launcher for every program. Kernels compiled with
+// grid-as-loop instead take the three i32 grid sizes followed by an i64
+// [begin, end) range of linearized program ids, and are called once per chunk
+// of programs.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TRITON_SHARED_RUNTIME_LAUNCHER_H
+#define TRITON_SHARED_RUNTIME_LAUNCHER_H
+
+#include "ExecutionEngine/CRunnerUtils.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace triton_shared {
+
+/// Signature of the packed kernel entry point.
+using PackedKernelFn = void (*)(void **);
+
+/// Number of trailing i32 arguments holding the grid size and program id.
+constexpr unsigned kProgramInfoArgCount = 6;
+
+/// Number of trailing arguments of a grid-as-loop kernel: the i32 grid size
+/// and the i64 program range.
+constexpr unsigned kProgramRangeArgCount = 5;
+
+/// Returns true if `kind` is a valid signature descriptor character.
+bool isValidArgKind(char kind);
+
+/// The argument values of one launch, laid out the way the packed entry point
+/// expects them. Addresses handed to the kernel point into this object, so it
+/// can be moved but not copied.
+class KernelArguments {
+public:
+  /// `signature` must only contain valid descriptor characters.
+  explicit KernelArguments(std::string signature);
+
+  KernelArguments(KernelArguments &&) = default;
+  KernelArguments &operator=(KernelArguments &&) = default;
+  KernelArguments(const KernelArguments &) = delete;
+  KernelArguments &operator=(const KernelArguments &) = delete;
+
+  const std::string &getSignature() const { return signature; }
+
+  /// Sets the Triton argument `index`, which must be a pointer.
+  void setPointer(size_t index, void *ptr);
+
+  /// Sets the Triton argument `index`, which must be a scalar of type T.
+  template <typename T>
+  void setScalar(size_t index, T value) {
+    static_assert(sizeof(T) <= sizeof(uint64_t), "scalar too wide");
+    std::memcpy(&slots[slotIndex[index]], &value, sizeof(T));
+  }
+
+  /// Runs every program of a gridX x gridY x gridZ grid on the GridExecutor.
+  void launch(PackedKernelFn fn, int gridX, int gridY, int gridZ) const;
+
+  /// Same as `launch` for kernels compiled with grid-as-loop: `fn` is called
+  /// once for every chunk of programs handed out by the GridExecutor.
+  void launchRange(PackedKernelFn fn, int gridX, int gridY, int gridZ) const;
+
+private:
+  std::string signature;
+  // First packed argument of every Triton argument.
+  std::vector<size_t> slotIndex;
+  // One 8-byte slot per packed argument, excluding the program info. Scalars
+  // narrower than a slot live in its low bytes.
+  std::vector<uint64_t> slots;
+  // Rank-0 descriptors of the pointer arguments; the kernel only reads the
+  // base and aligned pointers.
+  std::vector<StridedMemRefType<char, 0>> descriptors;
+};
+
+} // namespace triton_shared
+
+#endif // TRITON_SHARED_RUNTIME_LAUNCHER_H
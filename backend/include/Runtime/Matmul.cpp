@@ -0,0 +1,363 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Matmul.h"
+#include "GridExecutor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace triton_shared {
+
+namespace {
+
+// Multiplications below this many flops run on the calling thread.
+constexpr int64_t kParallelFlops = int64_t(1) << 27;
+
+// Columns of B packed at once, sized with the kc rows of a block for the L3
+// cache.
+constexpr int64_t kNC = 2048;
+
+struct GemmArgs {
+  MatmulInputType inputType;
+  int64_t m, n, k;
+  MatrixView a, b, c;
+};
+
+struct Half {
+  uint16_t bits;
+};
+
+struct BFloat {
+  uint16_t bits;
+};
+
+inline float bitsToFloat(uint32_t bits) {
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+inline float toFloat(float value) { return value; }
+
+inline float toFloat(BFloat value) {
+  return bitsToFloat(static_cast<uint32_t>(value.bits) << 16);
+}
+
+inline float toFloat(Half value) {
+  uint32_t sign = static_cast<uint32_t>(value.bits & 0x8000) << 16;
+  uint32_t exponent = (value.bits >> 10) & 0x1f;
+  uint32_t mantissa = value.bits & 0x3ff;
+  if (exponent == 0x1f)
+    return bitsToFloat(sign | 0x7f800000 | (mantissa << 13));
+  if (exponent != 0)
+    return bitsToFloat(sign | ((exponent + 112) << 23) | (mantissa << 13));
+  if (mantissa == 0)
+    return bitsToFloat(sign);
+  // Subnormal halves are normal floats.
+  exponent = 113;
+  while (!(mantissa & 0x400)) {
+    mantissa <<= 1;
+    --exponent;
+  }
+  return bitsToFloat(sign | (exponent << 23) | ((mantissa & 0x3ff) << 13));
+}
+
+#if defined(__GNUC__)
+
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+
+// Blocking of one instruction set: the microkernel computes MR x NR tiles of
+// C, where NR is a number of vectors, from panels of KC rows of B and MC
+// rows of A.
+template <int VectorBytes, int MRows, int NVectors, int KBlock, int MTiles>
+struct GemmConfig {
+  static constexpr int kLanes = VectorBytes / sizeof(float);
+  static constexpr int kMR = MRows;
+  static constexpr int kNVectors = NVectors;
+  static constexpr int kNR = NVectors * kLanes;
+  static constexpr int kKC = KBlock;
+  static constexpr int kMC = MTiles * MRows;
+  typedef float Vector __attribute__((vector_size(VectorBytes), aligned(4)));
+};
+
+// 6 x 16 and 8 x 32 tiles keep 12 and 16 accumulators in registers, leaving
+// room for the vectors of B and the broadcast element of A.
+using BaselineConfig = GemmConfig<16, 4, 2, 256, 24>;
+using AVX2Config = GemmConfig<32, 6, 2, 256, 16>;
+using AVX512Config = GemmConfig<64, 8, 2, 256, 16>;
+
+// Packs the mc x kc block of A at `a` into panels of MR rows, each stored
+// column by column, zero-padding the rows of the last panel.
+template <class Config, typename T>
+ALWAYS_INLINE void packA(const T *a, int64_t rowStride, int64_t colStride,
+                         int64_t mc, int64_t kc, float *packed) {
+  for (int64_t i0 = 0; i0 < mc; i0 += Config::kMR) {
+    int64_t mr = std::min<int64_t>(Config::kMR, mc - i0);
+    for (int64_t p = 0; p < kc; ++p) {
+      const T *column = a + i0 * rowStride + p * colStride;
+      float *dst = packed + p * Config::kMR;
+      for (int64_t i = 0; i < mr; ++i)
+        dst[i] = toFloat(column[i * rowStride]);
+      for (int64_t i = mr; i < Config::kMR; ++i)
+        dst[i] = 0.0f;
+    }
+    packed += kc * Config::kMR;
+  }
+}
+
+// Packs the kc x nc block of B at `b` into panels of NR columns, each stored
+// row by row, zero-padding the columns of the last panel.
+template <class Config, typename T>
+ALWAYS_INLINE void packB(const T *b, int64_t rowStride, int64_t colStride,
+                         int64_t kc, int64_t nc, float *packed) {
+  for (int64_t j0 = 0; j0 < nc; j0 += Config::kNR) {
+    int64_t nr = std::min<int64_t>(Config::kNR, nc - j0);
+    for (int64_t p = 0; p < kc; ++p) {
+      const T *row = b + p * rowStride + j0 * colStride;
+      float *dst = packed + p * Config::kNR;
+      if (colStride == 1) {
+        for (int64_t j = 0; j < nr; ++j)
+          dst[j] = toFloat(row[j]);
+      } else {
+        for (int64_t j = 0; j < nr; ++j)
+          dst[j] = toFloat(row[j * colStride]);
+      }
+      for (int64_t j = nr; j < Config::kNR; ++j)
+        dst[j] = 0.0f;
+    }
+    packed += kc * Config::kNR;
+  }
+}
+
+// Adds the product of a packed panel of A and a packed panel of B to the
+// mr x nr tile of C at `c`. The accumulators live in registers for the
+// whole kc loop, so each element of the panels is loaded once.
+template <class Config>
+ALWAYS_INLINE void microKernel(int64_t kc, const float *a, const float *b,
+                               float *c, int64_t rowStride, int64_t colStride,
+                               int64_t mr, int64_t nr) {
+  using Vector = typename Config::Vector;
+  constexpr int kMR = Config::kMR;
+  constexpr int kNV = Config::kNVectors;
+  Vector acc[kMR][kNV] = {};
+  for (int64_t p = 0; p < kc; ++p) {
+    Vector bv[kNV];
+#pragma GCC unroll 8
+    for (int j = 0; j < kNV; ++j)
+      bv[j] = *reinterpret_cast<const Vector *>(b + j * Config::kLanes);
+#pragma GCC unroll 16
+    for (int i = 0; i < kMR; ++i) {
+      Vector av = Vector{} + a[i];
+#pragma GCC unroll 8
+      for (int j = 0; j < kNV; ++j)
+        acc[i][j] += av * bv[j];
+    }
+    a += kMR;
+    b += Config::kNR;
+  }
+
+  if (mr == kMR && nr == Config::kNR && colStride == 1) {
+#pragma GCC unroll 16
+    for (int i = 0; i < kMR; ++i) {
+#pragma GCC unroll 8
+      for (int j = 0; j < kNV; ++j) {
+        Vector *dst =
+            reinterpret_cast<Vector *>(c + i * rowStride + j * Config::kLanes);
+        *dst += acc[i][j];
+      }
+    }
+    return;
+  }
+
+  float tile[kMR][Config::kNR];
+  std::memcpy(tile, acc, sizeof(tile));
+  for (int64_t i = 0; i < mr; ++i)
+    for (int64_t j = 0; j < nr; ++j)
+      c[i * rowStride + j * colStride] += tile[i][j];
+}
+
+template <class Config, typename T>
+ALWAYS_INLINE void packBlockOfB(const GemmArgs &args, int64_t jc, int64_t nc,
+                                int64_t pc, int64_t kc, float *packed) {
+  const MatrixView &b = args.b;
+  packB<Config>(static_cast<const T *>(b.data) + pc * b.rowStride +
+                    jc * b.colStride,
+                b.rowStride, b.colStride, kc, nc, packed);
+}
+
+// Computes the rows of C in the MC blocks [begin, end) for the packed
+// kc x nc block of B.
+template <class Config, typename T>
+ALWAYS_INLINE void computeBlocks(const GemmArgs &args, int64_t jc, int64_t nc,
+                                 int64_t pc, int64_t kc, const float *packedB,
+                                 int64_t begin, int64_t end) {
+  thread_local std::vector<float> packedA;
+  packedA.resize(Config::kMC * Config::kKC);
+  const MatrixView &a = args.a;
+  const MatrixView &c = args.c;
+  for (int64_t block = begin; block < end; ++block) {
+    int64_t ic = block * Config::kMC;
+    int64_t mc = std::min<int64_t>(Config::kMC, args.m - ic);
+    packA<Config>(static_cast<const T *>(a.data) + ic * a.rowStride +
+                      pc * a.colStride,
+                  a.rowStride, a.colStride, mc, kc, packedA.data());
+    float *cBlock =
+        static_cast<float *>(c.data) + ic * c.rowStride + jc * c.colStride;
+    for (int64_t jr = 0; jr < nc; jr += Config::kNR) {
+      const float *bPanel = packedB + jr * kc;
+      for (int64_t ir = 0; ir < mc; ir += Config::kMR)
+        microKernel<Config>(kc, packedA.data() + ir * kc, bPanel,
+                            cBlock + ir * c.rowStride + jr * c.colStride,
+                            c.rowStride, c.colStride,
+                            std::min<int64_t>(Config::kMR, mc - ir),
+                            std::min<int64_t>(Config::kNR, nc - jr));
+    }
+  }
+}
+
+template <class Config>
+ALWAYS_INLINE void dispatchPackB(const GemmArgs &args, int64_t jc, int64_t nc,
+                                 int64_t pc, int64_t kc, float *packed) {
+  switch (args.inputType) {
+  case MatmulInputType::F32:
+    return packBlockOfB<Config, float>(args, jc, nc, pc, kc, packed);
+  case MatmulInputType::F16:
+    return packBlockOfB<Config, Half>(args, jc, nc, pc, kc, packed);
+  case MatmulInputType::BF16:
+    return packBlockOfB<Config, BFloat>(args, jc, nc, pc, kc, packed);
+  }
+}
+
+template <class Config>
+ALWAYS_INLINE void dispatchComputeBlocks(const GemmArgs &args, int64_t jc,
+                                         int64_t nc, int64_t pc, int64_t kc,
+                                         const float *packedB, int64_t begin,
+                                         int64_t end) {
+  switch (args.inputType) {
+  case MatmulInputType::F32:
+    return computeBlocks<Config, float>(args, jc, nc, pc, kc, packedB, begin,
+                                        end);
+  case MatmulInputType::F16:
+    return computeBlocks<Config, Half>(args, jc, nc, pc, kc, packedB, begin,
+                                       end);
+  case MatmulInputType::BF16:
+    return computeBlocks<Config, BFloat>(args, jc, nc, pc, kc, packedB, begin,
+                                         end);
+  }
+}
+
+struct GemmKernel {
+  int64_t mr, nr, mc, kc;
+  void (*packB)(const GemmArgs &, int64_t, int64_t, int64_t, int64_t, float *);
+  void (*computeBlocks)(const GemmArgs &, int64_t, int64_t, int64_t, int64_t,
+                        const float *, int64_t, int64_t);
+};
+
+// Instantiates the kernel of a configuration in functions compiled for
+// `TARGET`, into which the templates above are inlined.
+#define DEFINE_GEMM_KERNEL(NAME, TARGET, CONFIG)                               \
+  TARGET void NAME##PackB(const GemmArgs &args, int64_t jc, int64_t nc,        \
+                          int64_t pc, int64_t kc, float *packed) {             \
+    dispatchPackB<CONFIG>(args, jc, nc, pc, kc, packed);                       \
+  }                                                                            \
+  TARGET void NAME##ComputeBlocks(const GemmArgs &args, int64_t jc,            \
+                                  int64_t nc, int64_t pc, int64_t kc,          \
+                                  const float *packedB, int64_t begin,         \
+                                  int64_t end) {                               \
+    dispatchComputeBlocks<CONFIG>(args, jc, nc, pc, kc, packedB, begin, end);  \
+  }                                                                            \
+  const GemmKernel NAME##Kernel = {CONFIG::kMR,    CONFIG::kNR,                \
+                                   CONFIG::kMC,    CONFIG::kKC,                \
+                                   NAME##PackB,    NAME##ComputeBlocks};
+
+DEFINE_GEMM_KERNEL(baseline, , BaselineConfig)
+#if defined(__x86_64__) || defined(__i386__)
+DEFINE_GEMM_KERNEL(avx2, __attribute__((target("avx2,fma"))), AVX2Config)
+DEFINE_GEMM_KERNEL(avx512, __attribute__((target("avx512f"))), AVX512Config)
+#endif
+
+#undef DEFINE_GEMM_KERNEL
+
+const GemmKernel &selectKernel() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return avx512Kernel;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return avx2Kernel;
+#endif
+  return baselineKernel;
+}
+
+void runGemm(const GemmArgs &args) {
+  static const GemmKernel &kernel = selectKernel();
+  thread_local std::vector<float> packedB;
+  int64_t numBlocks = (args.m + kernel.mc - 1) / kernel.mc;
+  bool parallel =
+      numBlocks > 1 && 2 * args.m * args.n * args.k >= kParallelFlops;
+  for (int64_t jc = 0; jc < args.n; jc += kNC) {
+    int64_t nc = std::min(kNC, args.n - jc);
+    packedB.resize((nc + kernel.nr - 1) / kernel.nr * kernel.nr * kernel.kc);
+    for (int64_t pc = 0; pc < args.k; pc += kernel.kc) {
+      int64_t kc = std::min(kernel.kc, args.k - pc);
+      kernel.packB(args, jc, nc, pc, kc, packedB.data());
+      if (!parallel) {
+        kernel.computeBlocks(args, jc, nc, pc, kc, packedB.data(), 0,
+                             numBlocks);
+        continue;
+      }
+      // packedB is thread local: pass the workers this thread's panel.
+      const float *panel = packedB.data();
+      GridExecutor::get().parallelFor(
+          numBlocks, [&](int64_t begin, int64_t end) {
+            kernel.computeBlocks(args, jc, nc, pc, kc, panel, begin, end);
+          });
+    }
+  }
+}
+
+#else
+
+template <typename T> void runGemm(const GemmArgs &args) {
+  const T *a = static_cast<const T *>(args.a.data);
+  const T *b = static_cast<const T *>(args.b.data);
+  float *c = static_cast<float *>(args.c.data);
+  for (int64_t i = 0; i < args.m; ++i) {
+    for (int64_t p = 0; p < args.k; ++p) {
+      float aValue = toFloat(a[i * args.a.rowStride + p * args.a.colStride]);
+      for (int64_t j = 0; j < args.n; ++j)
+        c[i * args.c.rowStride + j * args.c.colStride] +=
+            aValue * toFloat(b[p * args.b.rowStride + j * args.b.colStride]);
+    }
+  }
+}
+
+void runGemm(const GemmArgs &args) {
+  switch (args.inputType) {
+  case MatmulInputType::F32:
+    return runGemm<float>(args);
+  case MatmulInputType::F16:
+    return runGemm<Half>(args);
+  case MatmulInputType::BF16:
+    return runGemm<BFloat>(args);
+  }
+}
+
+#endif
+
+} // namespace
+
+void matmul(MatmulInputType inputType, int64_t m, int64_t n, int64_t k,
+            MatrixView a, MatrixView b, MatrixView c) {
+  if (m <= 0 || n <= 0 || k <= 0)
+    return;
+  runGemm({inputType, m, n, k, a, b, c});
+}
+
+} // namespace triton_shared
@@ -0,0 +1,45 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+//
+// Matrix multiplication behind the `tt.dot` ops of kernels, see
+// triton-shared-matmul-to-library. The operands are multiplied block by block:
+// panels of B and of A sized for the L3/L2 and L1 caches are packed into
+// contiguous float buffers, then a register-blocked microkernel computes one
+// MR x NR tile of C at a time with SIMD fused multiply-adds. The microkernel is
+// compiled for AVX-512, AVX2 and baseline SIMD, and the widest one the host
+// supports is picked on the first call.
+//
+// A single multiplication large enough to be worth it is split over the
+// grid executor, which runs it serially when called from a program of a
+// multi-program launch.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TRITON_SHARED_RUNTIME_MATMUL_H
+#define TRITON_SHARED_RUNTIME_MATMUL_H
+
+#include <cstdint>
+
+namespace triton_shared {
+
+enum class MatmulInputType { F32, F16, BF16 };
+
+/// A row-major or strided matrix; the strides count elements.
+struct MatrixView {
+  void *data;
+  int64_t rowStride;
+  int64_t colStride;
+};
+
+/// Computes C += A * B, where A is m x k and B is k x n with elements of
+/// `inputType`, and C is m x n with f32 elements.
+void matmul(MatmulInputType inputType, int64_t m, int64_t n, int64_t k,
+            MatrixView a, MatrixView b, MatrixView c);
+
+} // namespace triton_shared
+
+#endif // TRITON_SHARED_RUNTIME_MATMUL_H
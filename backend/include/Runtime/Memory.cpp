@@ -0,0 +1,525 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Memory.h"
+#include "Topology.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace triton_shared {
+
+namespace {
+
+// Minimum alignment of every allocation, a cache line, so that vector loads
+// of buffers never straddle one needlessly.
+constexpr uint64_t kMinAlignment = 64;
+
+// Size of a transparent huge page on the hosts we run on. Buffers of at least
+// this size get their own mapping, aligned to it and eligible for huge pages.
+constexpr uint64_t kHugePageSize = 2 << 20;
+
+// Buffers of at least this size get their own pages under the first-touch
+// and interleave policies; smaller ones come from malloc.
+constexpr uint64_t kPlacedAllocationThreshold = 1 << 20;
+
+// Buffers up to this size come from the arena while a program runs.
+constexpr uint64_t kArenaMaxAllocation = 64 << 10;
+
+// Minimum size of the arena chunks requested from the system.
+constexpr uint64_t kArenaChunkSize = 1 << 20;
+
+// Buffers larger than kArenaMaxAllocation and up to 2^kMaxSizeClassLog2 bytes
+// are recycled through per-thread free lists of power-of-two size classes,
+// each holding at most kMaxCachedBlocks blocks. Size class blocks have room
+// for any alignment up to kMaxSizeClassAlignment.
+constexpr unsigned kMinSizeClassLog2 = 17;
+constexpr unsigned kMaxSizeClassLog2 = 26;
+constexpr unsigned kNumSizeClasses = kMaxSizeClassLog2 - kMinSizeClassLog2 + 1;
+constexpr unsigned kMaxCachedBlocks = 2;
+constexpr uint64_t kMaxSizeClassAlignment = 4096;
+
+enum class BlockKind : uint32_t { System, Arena, SizeClass };
+
+// Blocks currently held from the system, see getNumSystemBlocks, and the most
+// held at once since the last resetPeakNumSystemBlocks.
+std::atomic<uint64_t> numSystemBlocks{0};
+std::atomic<uint64_t> peakSystemBlocks{0};
+
+void countSystemBlock() {
+  uint64_t num = numSystemBlocks.fetch_add(1, std::memory_order_relaxed) + 1;
+  uint64_t peak = peakSystemBlocks.load(std::memory_order_relaxed);
+  while (peak < num && !peakSystemBlocks.compare_exchange_weak(
+                           peak, num, std::memory_order_relaxed))
+    ;
+}
+
+// Precedes every allocation and records how to free it.
+struct AllocationHeader {
+  // System and SizeClass: start of the block, Arena: arena top before the
+  // allocation.
+  char *base;
+  // System and SizeClass: size of the block if it was mapped, 0 if it came
+  // from malloc. Arena: size of the allocation.
+  uint64_t size;
+  BlockKind kind;
+  uint32_t sizeClass;
+};
+
+uint64_t roundUp(uint64_t value, uint64_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+AllocationHeader *getHeader(void *ptr) {
+  return static_cast<AllocationHeader *>(ptr) - 1;
+}
+
+// Returns the first address after `base` that leaves room for a header and is
+// aligned to `alignment`.
+char *placeAllocation(char *base, uint64_t alignment) {
+  uintptr_t address =
+      reinterpret_cast<uintptr_t>(base) + sizeof(AllocationHeader);
+  return base + ((address + alignment - 1) / alignment * alignment -
+                 reinterpret_cast<uintptr_t>(base));
+}
+
+bool isArenaEnabled() {
+  static const bool enabled = [] {
+    const char *env = std::getenv("TRITON_SHARED_ARENA");
+    return !env || std::strcmp(env, "0") != 0;
+  }();
+  return enabled;
+}
+
+NumaPolicy readNumaPolicy() {
+  const char *env = std::getenv("TRITON_SHARED_NUMA_POLICY");
+  if (!env)
+    return NumaPolicy::Default;
+  if (std::strcmp(env, "first-touch") == 0)
+    return NumaPolicy::FirstTouch;
+  if (std::strcmp(env, "interleave") == 0)
+    return NumaPolicy::Interleave;
+  return NumaPolicy::Default;
+}
+
+#ifdef __linux__
+enum class HugePageMode { Off, Transparent, HugeTLB };
+
+HugePageMode getHugePageMode() {
+  static const HugePageMode mode = [] {
+    const char *env = std::getenv("TRITON_SHARED_HUGE_PAGES");
+    if (!env)
+      return HugePageMode::Transparent;
+    if (std::strcmp(env, "0") == 0)
+      return HugePageMode::Off;
+    if (std::strcmp(env, "hugetlb") == 0)
+      return HugePageMode::HugeTLB;
+    return HugePageMode::Transparent;
+  }();
+  return mode;
+}
+
+// From <numaif.h>, which is not always installed.
+constexpr int kMpolInterleave = 3;
+
+void interleave(void *addr, uint64_t size) {
+#ifdef SYS_mbind
+  const CPUTopology &topology = getCPUTopology();
+  unsigned maxNode = 0;
+  for (const NumaNode &node : topology.nodes)
+    maxNode = std::max(maxNode, node.id);
+  constexpr unsigned kBitsPerWord = 8 * sizeof(unsigned long);
+  std::vector<unsigned long> mask(maxNode / kBitsPerWord + 1, 0);
+  for (const NumaNode &node : topology.nodes)
+    mask[node.id / kBitsPerWord] |= 1ul << (node.id % kBitsPerWord);
+  // Best effort: on failure the pages keep the default placement.
+  (void)syscall(SYS_mbind, addr, size, kMpolInterleave, mask.data(),
+                mask.size() * kBitsPerWord, 0);
+#endif
+}
+
+void *mapPages(uint64_t size, int flags) {
+  void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+  return mapping == MAP_FAILED ? nullptr : mapping;
+}
+
+// Maps `lead` bytes of small pages followed by `size` bytes, a multiple of
+// kHugePageSize, backed by huge pages where the kernel allows it. Returns the
+// start of the small pages.
+char *mapHugePages(uint64_t lead, uint64_t size, HugePageMode mode,
+                   uint64_t pageSize) {
+#ifdef MAP_HUGETLB
+  // Pages from the pool reserved by the administrator; there may be none. The
+  // small pages go right in front of them if that range is free.
+  if (mode == HugePageMode::HugeTLB) {
+    if (char *huge = static_cast<char *>(mapPages(size, MAP_HUGETLB))) {
+      void *front = mmap(huge - lead, lead, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (front == huge - lead)
+        return huge - lead;
+      if (front != MAP_FAILED)
+        munmap(front, lead);
+      munmap(huge, size);
+    }
+  }
+#endif
+  // Transparent huge pages need a huge page aligned range, so map enough to
+  // align the end of the small pages and trim the ends.
+  uint64_t reserved = lead + size + kHugePageSize - pageSize;
+  char *mapping = static_cast<char *>(mapPages(reserved, 0));
+  if (!mapping)
+    return nullptr;
+  uintptr_t address = reinterpret_cast<uintptr_t>(mapping) + lead;
+  char *base = mapping + (roundUp(address, kHugePageSize) - address);
+  if (base != mapping)
+    munmap(mapping, base - mapping);
+  char *end = base + lead + size;
+  if (end != mapping + reserved)
+    munmap(end, mapping + reserved - end);
+#ifdef MADV_HUGEPAGE
+  // Best effort: without it the pages stay small.
+  (void)madvise(base + lead, size, MADV_HUGEPAGE);
+#endif
+  return base;
+}
+#endif
+
+// Gets a block of at least `size` bytes from the system, backed by huge pages
+// if it is large enough and placed according to the NUMA policy. Sets
+// `mappedSize` to the size of the mapping, or to 0 if the block came from
+// malloc.
+char *allocateSystemBlock(uint64_t size, uint64_t &mappedSize) {
+  mappedSize = 0;
+#ifdef __linux__
+  NumaPolicy policy = getNumaPolicy();
+  HugePageMode hugePages = getHugePageMode();
+  bool huge = hugePages != HugePageMode::Off && size >= kHugePageSize;
+  if (huge ||
+      (policy != NumaPolicy::Default && size >= kPlacedAllocationThreshold)) {
+    uint64_t pageSize = sysconf(_SC_PAGESIZE);
+    uint64_t mapSize = roundUp(size, pageSize);
+    char *mapping;
+    if (huge) {
+      // Huge pages only back the block past room for a header and alignment,
+      // so that a block of a power of two plus that room, like a size class
+      // block, fills its huge pages exactly instead of spilling into one more.
+      uint64_t lead =
+          roundUp(kMaxSizeClassAlignment + sizeof(AllocationHeader), pageSize);
+      uint64_t hugeSize = roundUp(mapSize - lead, kHugePageSize);
+      mapSize = lead + hugeSize;
+      mapping = mapHugePages(lead, hugeSize, hugePages, pageSize);
+    } else {
+      mapping = static_cast<char *>(mapPages(mapSize, 0));
+    }
+    if (!mapping)
+      return nullptr;
+    // The pages are only placed when first touched.
+    if (policy == NumaPolicy::Interleave)
+      interleave(mapping, mapSize);
+    mappedSize = mapSize;
+    countSystemBlock();
+    return mapping;
+  }
+#endif
+  char *block = static_cast<char *>(malloc(size));
+  if (block)
+    countSystemBlock();
+  return block;
+}
+
+void freeSystemBlock(char *base, uint64_t mappedSize) {
+  numSystemBlocks.fetch_sub(1, std::memory_order_relaxed);
+#ifdef __linux__
+  if (mappedSize) {
+    munmap(base, mappedSize);
+    return;
+  }
+#endif
+  free(base);
+}
+
+void *allocateSystem(uint64_t size, uint64_t alignment) {
+  uint64_t mappedSize;
+  char *base = allocateSystemBlock(
+      size + alignment + sizeof(AllocationHeader), mappedSize);
+  if (!base)
+    return nullptr;
+  char *ptr = placeAllocation(base, alignment);
+  *getHeader(ptr) = {base, mappedSize, BlockKind::System, 0};
+  return ptr;
+}
+
+// Bump allocator for the buffers of the program running on a thread.
+class Arena {
+public:
+  ~Arena() {
+    for (const Chunk &chunk : chunks)
+      freeSystemBlock(chunk.data, chunk.mappedSize);
+  }
+
+  void *allocate(uint64_t size, uint64_t alignment) {
+    for (;;) {
+      if (current < chunks.size()) {
+        const Chunk &chunk = chunks[current];
+        char *ptr = placeAllocation(top, alignment);
+        if (ptr + size <= chunk.data + chunk.size) {
+          *getHeader(ptr) = {top, size, BlockKind::Arena, 0};
+          top = ptr + size;
+          return ptr;
+        }
+        if (++current < chunks.size()) {
+          top = chunks[current].data;
+          continue;
+        }
+      }
+      uint64_t chunkSize = std::max(
+          kArenaChunkSize, size + alignment + sizeof(AllocationHeader));
+      Chunk chunk{nullptr, chunkSize, 0};
+      chunk.data = allocateSystemBlock(chunkSize, chunk.mappedSize);
+      if (!chunk.data)
+        return nullptr;
+      chunks.push_back(chunk);
+      current = chunks.size() - 1;
+      top = chunk.data;
+    }
+  }
+
+  // Pops the most recent allocation, the common case of a buffer freed at
+  // the end of the loop iteration that allocated it. Anything else waits for
+  // the end of the program.
+  void free(void *ptr) {
+    AllocationHeader *header = getHeader(ptr);
+    // A chunk may directly follow the previous one in memory; only pop
+    // allocations of the current chunk.
+    if (static_cast<char *>(ptr) + header->size == top &&
+        top != chunks[current].data)
+      top = header->base;
+  }
+
+  // Position of the next allocation, to rewind to at the end of a nested
+  // program.
+  struct Mark {
+    size_t current;
+    char *top;
+  };
+
+  Mark getMark() const { return {current, top}; }
+
+  void rewind(Mark mark) {
+    current = mark.current;
+    // The arena may have had no chunk yet when the mark was taken.
+    top = mark.top ? mark.top : chunks.empty() ? nullptr : chunks.front().data;
+  }
+
+  void reset() {
+    if (chunks.size() > 1) {
+      // The program needed several chunks; give the next one a single chunk
+      // as large as all of them.
+      uint64_t totalSize = 0;
+      for (const Chunk &chunk : chunks) {
+        totalSize += chunk.size;
+        freeSystemBlock(chunk.data, chunk.mappedSize);
+      }
+      chunks.clear();
+      Chunk chunk{nullptr, totalSize, 0};
+      chunk.data = allocateSystemBlock(totalSize, chunk.mappedSize);
+      if (chunk.data)
+        chunks.push_back(chunk);
+    }
+    current = 0;
+    top = chunks.empty() ? nullptr : chunks.front().data;
+  }
+
+private:
+  struct Chunk {
+    char *data;
+    uint64_t size;
+    uint64_t mappedSize;
+  };
+  std::vector<Chunk> chunks;
+  size_t current = 0;
+  char *top = nullptr;
+};
+
+// Per-thread free lists of the size class blocks.
+class SizeClassCache {
+public:
+  ~SizeClassCache() {
+    for (auto &list : lists)
+      for (const Block &block : list)
+        freeSystemBlock(block.base, block.mappedSize);
+  }
+
+  static uint64_t getBlockSize(unsigned sizeClass) {
+    return (uint64_t(1) << (sizeClass + kMinSizeClassLog2)) +
+           kMaxSizeClassAlignment + sizeof(AllocationHeader);
+  }
+
+  void *allocate(unsigned sizeClass, uint64_t alignment) {
+    std::vector<Block> &list = lists[sizeClass];
+    Block block;
+    if (!list.empty()) {
+      block = list.back();
+      list.pop_back();
+    } else {
+      block.base = allocateSystemBlock(getBlockSize(sizeClass),
+                                       block.mappedSize);
+      if (!block.base)
+        return nullptr;
+    }
+    char *ptr = placeAllocation(block.base, alignment);
+    *getHeader(ptr) = {block.base, block.mappedSize, BlockKind::SizeClass,
+                       sizeClass};
+    return ptr;
+  }
+
+  void free(void *ptr) {
+    AllocationHeader *header = getHeader(ptr);
+    std::vector<Block> &list = lists[header->sizeClass];
+    if (list.size() < kMaxCachedBlocks)
+      list.push_back({header->base, header->size});
+    else
+      freeSystemBlock(header->base, header->size);
+  }
+
+private:
+  struct Block {
+    char *base;
+    uint64_t mappedSize;
+  };
+  std::vector<Block> lists[kNumSizeClasses];
+};
+
+// Returns the size class holding `size` bytes, or kNumSizeClasses if there is
+// none.
+unsigned getSizeClass(uint64_t size) {
+  unsigned log2 = kMinSizeClassLog2;
+  while (log2 <= kMaxSizeClassLog2 && (uint64_t(1) << log2) < size)
+    ++log2;
+  return log2 - kMinSizeClassLog2;
+}
+
+thread_local Arena arena;
+thread_local SizeClassCache sizeClassCache;
+
+// Buffers outside the arena that the program running on the thread has not
+// freed yet. Kernels are lowered without deallocations, so most of their
+// buffers are only released when the program ends.
+thread_local std::vector<void *> programBuffers;
+
+// What the programs running on the thread, innermost last, had allocated when
+// they began.
+struct ProgramMark {
+  size_t numBuffers;
+  Arena::Mark arena;
+};
+thread_local std::vector<ProgramMark> programMarks;
+
+bool isInProgram() { return !programMarks.empty(); }
+
+// Allocates a buffer outside the arena, from a size class or the system.
+void *allocateBlock(uint64_t size, uint64_t alignment) {
+  if (isArenaEnabled() && size > kArenaMaxAllocation &&
+      alignment <= kMaxSizeClassAlignment) {
+    unsigned sizeClass = getSizeClass(size);
+    if (sizeClass < kNumSizeClasses)
+      return sizeClassCache.allocate(sizeClass, alignment);
+  }
+  return allocateSystem(size, alignment);
+}
+
+void freeBlock(void *ptr) {
+  AllocationHeader *header = getHeader(ptr);
+  if (header->kind == BlockKind::SizeClass)
+    sizeClassCache.free(ptr);
+  else
+    freeSystemBlock(header->base, header->size);
+}
+
+} // namespace
+
+NumaPolicy getNumaPolicy() {
+  static const NumaPolicy policy = readNumaPolicy();
+  return policy;
+}
+
+void *allocateMemory(uint64_t size, uint64_t alignment) {
+  alignment = std::max(alignment, kMinAlignment);
+  if (isArenaEnabled() && isInProgram() && size <= kArenaMaxAllocation)
+    return arena.allocate(size, alignment);
+  void *ptr = allocateBlock(size, alignment);
+  if (ptr && isInProgram())
+    programBuffers.push_back(ptr);
+  return ptr;
+}
+
+void freeMemory(void *ptr) {
+  if (!ptr)
+    return;
+  if (getHeader(ptr)->kind == BlockKind::Arena) {
+    arena.free(ptr);
+    return;
+  }
+  if (isInProgram()) {
+    // Usually the most recent buffer. The order is kept, so that each nested
+    // program releases the buffers past its mark.
+    auto it = std::find(programBuffers.rbegin(), programBuffers.rend(), ptr);
+    if (it != programBuffers.rend())
+      programBuffers.erase(std::next(it).base());
+  }
+  freeBlock(ptr);
+}
+
+uint64_t getNumSystemBlocks() {
+  return numSystemBlocks.load(std::memory_order_relaxed);
+}
+
+uint64_t getPeakNumSystemBlocks() {
+  return peakSystemBlocks.load(std::memory_order_relaxed);
+}
+
+void resetPeakNumSystemBlocks() {
+  peakSystemBlocks.store(numSystemBlocks.load(std::memory_order_relaxed),
+                         std::memory_order_relaxed);
+}
+
+void beginProgram() {
+  programMarks.push_back({programBuffers.size(), arena.getMark()});
+}
+
+void endProgram() {
+  ProgramMark mark = programMarks.back();
+  programMarks.pop_back();
+  while (programBuffers.size() > mark.numBuffers) {
+    freeBlock(programBuffers.back());
+    programBuffers.pop_back();
+  }
+  if (!isArenaEnabled())
+    return;
+  if (isInProgram())
+    arena.rewind(mark.arena);
+  else
+    arena.reset();
+}
+
+ProgramScope::ProgramScope() { beginProgram(); }
+
+ProgramScope::~ProgramScope() { endProgram(); }
+
+} // namespace triton_shared
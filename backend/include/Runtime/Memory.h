@@ -0,0 +1,99 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+//
+// Allocation of the buffers kernels create at run time, behind the mlirAlloc
+// family of CRunnerUtils. Kernels are lowered with the generic allocation
+// functions of the MemRef to LLVM conversion, which the kernel loader binds to
+// these entry points.
+//
+// Buffers never outlive the program that allocates them, so while a thread
+// runs a program (see ProgramScope) small buffers are carved out of a
+// per-thread arena that is reset when the program ends. Larger buffers are
+// rounded up to a power-of-two size class and recycled through per-thread
+// free lists; only the largest ones go back to the system on free. The
+// buffers a program does not free, which are most of them since kernels are
+// lowered without deallocations, are freed when the program ends. Setting
+// TRITON_SHARED_ARENA=0 sends every allocation to the system allocator, which
+// is useful with memory checkers.
+//
+// Every buffer is aligned to at least 64 bytes. On Linux, buffers of 2 MiB or
+// more get their own mapping, advised to use transparent huge pages past a
+// few small pages that hold the allocation header, which cuts the TLB misses
+// of large blocks. The TRITON_SHARED_HUGE_PAGES environment variable selects
+// the huge page policy:
+//
+//   1        transparent huge pages (default)
+//   hugetlb  pages of the reserved huge page pool, falling back to
+//            transparent huge pages when the pool is empty
+//   0        no huge pages, large buffers come from malloc
+//
+// The TRITON_SHARED_NUMA_POLICY environment variable selects where large
+// buffers are placed on multi-socket hosts:
+//
+//   default      malloc, the placement is up to the C library
+//   first-touch  fresh pages, placed on the node of the worker that first
+//                touches them
+//   interleave   fresh pages, interleaved across all NUMA nodes
+//
+// glibc also maps large blocks itself, but raises its mmap threshold up to
+// 32 MiB whenever such a block is freed. From then on malloc hands out heap
+// memory that some other worker touched first, possibly on another node;
+// first-touch keeps mapping fresh pages for every buffer of 1 MiB or more.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TRITON_SHARED_RUNTIME_MEMORY_H
+#define TRITON_SHARED_RUNTIME_MEMORY_H
+
+#include <cstdint>
+
+namespace triton_shared {
+
+enum class NumaPolicy { Default, FirstTouch, Interleave };
+
+/// Returns the policy set by TRITON_SHARED_NUMA_POLICY, read on the first
+/// call.
+NumaPolicy getNumaPolicy();
+
+/// Allocates `size` bytes aligned to `alignment`, and to at least 64 bytes.
+/// Returns null on failure.
+void *allocateMemory(uint64_t size, uint64_t alignment);
+
+/// Frees memory returned by allocateMemory. Memory allocated by a program may
+/// also be left alone; it is released when the program ends.
+void freeMemory(void *ptr);
+
+/// Returns the number of blocks currently held from the system: arena chunks,
+/// size class blocks in use or cached, and other buffers. Meant for leak
+/// checks.
+uint64_t getNumSystemBlocks();
+
+/// Returns the largest number of blocks held from the system at once since
+/// the last call to resetPeakNumSystemBlocks.
+uint64_t getPeakNumSystemBlocks();
+void resetPeakNumSystemBlocks();
+
+/// Marks the calling thread as running one program of a launch until the
+/// matching endProgram. Allocations made in between and not freed by then are
+/// released by endProgram, so they must not be freed on another thread.
+/// Programs may nest; each one releases the allocations made since it began.
+void beginProgram();
+void endProgram();
+
+/// Runs one program, see beginProgram, for the lifetime of the object.
+class ProgramScope {
+public:
+  ProgramScope();
+  ~ProgramScope();
+
+  ProgramScope(const ProgramScope &) = delete;
+  ProgramScope &operator=(const ProgramScope &) = delete;
+};
+
+} // namespace triton_shared
+
+#endif // TRITON_SHARED_RUNTIME_MEMORY_H
@@ -0,0 +1,112 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Stream.h"
+
+#include <algorithm>
+
+namespace triton_shared {
+
+Event::Event() : state(std::make_shared<State>()) {}
+
+bool Event::query() const {
+  std::lock_guard<std::mutex> lock(state->mutex);
+  return state->completed >= state->recorded;
+}
+
+void Event::synchronize() const {
+  std::unique_lock<std::mutex> lock(state->mutex);
+  uint64_t target = state->recorded;
+  state->cv.wait(lock, [&] { return state->completed >= target; });
+}
+
+Stream::Stream() : worker([this] { run(); }) {}
+
+Stream::~Stream() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    shuttingDown = true;
+  }
+  workCv.notify_all();
+  worker.join();
+}
+
+uint64_t Stream::enqueue(Task task) {
+  uint64_t sequence;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_back(std::move(task));
+    sequence = ++enqueued;
+  }
+  workCv.notify_one();
+  return sequence;
+}
+
+bool Stream::query() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return getCompleted() == enqueued;
+}
+
+void Stream::synchronize() {
+  std::unique_lock<std::mutex> lock(mutex);
+  uint64_t target = enqueued;
+  doneCv.wait(lock, [&] { return getCompleted() >= target; });
+}
+
+void Stream::recordEvent(Event &event) {
+  std::shared_ptr<Event::State> state = event.state;
+  uint64_t target;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    target = ++state->recorded;
+  }
+  enqueue([state, target] {
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->completed = std::max(state->completed, target);
+    }
+    state->cv.notify_all();
+  });
+}
+
+void Stream::waitEvent(const Event &event) {
+  std::shared_ptr<Event::State> state = event.state;
+  uint64_t target;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    target = state->recorded;
+    if (state->completed >= target)
+      return;
+  }
+  enqueue([state, target] {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&] { return state->completed >= target; });
+  });
+}
+
+void Stream::run() {
+  for (;;) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      workCv.wait(lock, [this] { return shuttingDown || !tasks.empty(); });
+      // Drain the queue before shutting down.
+      if (tasks.empty())
+        return;
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    task();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      completed.fetch_add(1, std::memory_order_release);
+    }
+    doneCv.notify_all();
+  }
+}
+
+} // namespace triton_shared
@@ -0,0 +1,107 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+//
+// Asynchronous CPU streams. A stream is an ordered queue of work drained by a
+// dedicated thread: work enqueued on a stream runs after all the work enqueued
+// before it, while the enqueuing thread carries on. Kernel launches drained
+// from a stream still run their grid on the GridExecutor.
+//
+// Events order work across streams, with the semantics of CUDA events:
+// recording an event on a stream captures all the work enqueued on it so far,
+// and making another stream wait for the event holds back the work enqueued on
+// that stream afterwards until the captured work has completed.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TRITON_SHARED_RUNTIME_STREAM_H
+#define TRITON_SHARED_RUNTIME_STREAM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace triton_shared {
+
+class Event {
+public:
+  Event();
+
+  /// Returns true if the work captured by the last record has completed, or
+  /// if the event was never recorded.
+  bool query() const;
+
+  /// Blocks until the work captured by the last record has completed.
+  void synchronize() const;
+
+private:
+  friend class Stream;
+
+  // Shared with the tasks that complete and wait for the event, which may
+  // outlive the event object.
+  struct State {
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint64_t recorded = 0;
+    uint64_t completed = 0;
+  };
+  std::shared_ptr<State> state;
+};
+
+class Stream {
+public:
+  using Task = std::function<void()>;
+
+  Stream();
+  /// Waits for the enqueued work to complete.
+  ~Stream();
+
+  Stream(const Stream &) = delete;
+  Stream &operator=(const Stream &) = delete;
+
+  /// Enqueues `task` and returns its sequence number, starting from 1.
+  uint64_t enqueue(Task task);
+
+  /// Number of tasks that have completed. Tasks complete in sequence order.
+  uint64_t getCompleted() const {
+    return completed.load(std::memory_order_acquire);
+  }
+
+  /// Returns true if all the enqueued work has completed.
+  bool query() const;
+
+  /// Blocks until all the enqueued work has completed.
+  void synchronize();
+
+  /// Captures the work enqueued so far in `event`.
+  void recordEvent(Event &event);
+
+  /// Holds back the work enqueued from now on until the work captured by the
+  /// last record of `event` has completed.
+  void waitEvent(const Event &event);
+
+private:
+  void run();
+
+  // Protects `tasks`, `enqueued` and `shuttingDown`.
+  mutable std::mutex mutex;
+  std::condition_variable workCv;
+  std::condition_variable doneCv;
+  std::deque<Task> tasks;
+  uint64_t enqueued = 0;
+  std::atomic<uint64_t> completed{0};
+  bool shuttingDown = false;
+  std::thread worker;
+};
+
+} // namespace triton_shared
+
+#endif // TRITON_SHARED_RUNTIME_STREAM_H
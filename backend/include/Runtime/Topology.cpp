@@ -0,0 +1,207 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Topology.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#endif
+
+namespace triton_shared {
+
+namespace {
+
+#ifdef __linux__
+// Parses a sysfs CPU list such as "0-3,8-11".
+std::vector<unsigned> parseCPUList(const std::string &list) {
+  std::vector<unsigned> cpus;
+  size_t pos = 0;
+  while (pos < list.size()) {
+    size_t end = list.find(',', pos);
+    if (end == std::string::npos)
+      end = list.size();
+    std::string range = list.substr(pos, end - pos);
+    pos = end + 1;
+    if (range.empty() || !std::isdigit(static_cast<unsigned char>(range[0])))
+      continue;
+    size_t dash = range.find('-');
+    unsigned first = std::strtoul(range.c_str(), nullptr, 10);
+    unsigned last = dash == std::string::npos
+                        ? first
+                        : std::strtoul(range.c_str() + dash + 1, nullptr, 10);
+    for (unsigned cpu = first; cpu <= last; ++cpu)
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+std::set<unsigned> getAllowedCPUs() {
+  std::set<unsigned> allowed;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) != 0)
+    return allowed;
+  for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    if (CPU_ISSET(cpu, &set))
+      allowed.insert(cpu);
+  return allowed;
+}
+
+bool readLine(const std::string &path, std::string &line) {
+  std::ifstream file(path);
+  return static_cast<bool>(std::getline(file, line));
+}
+
+// Parses a sysfs size such as "48K".
+uint64_t parseSize(const std::string &size) {
+  char *suffix = nullptr;
+  uint64_t value = std::strtoull(size.c_str(), &suffix, 10);
+  switch (*suffix) {
+  case 'K':
+    return value << 10;
+  case 'M':
+    return value << 20;
+  case 'G':
+    return value << 30;
+  default:
+    return value;
+  }
+}
+
+unsigned countPhysicalCores(const std::vector<NumaNode> &nodes) {
+  std::set<std::pair<long, long>> cores;
+  for (const NumaNode &node : nodes) {
+    for (unsigned cpu : node.cpus) {
+      std::string dir =
+          "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+      std::string package, core;
+      if (!readLine(dir + "physical_package_id", package) ||
+          !readLine(dir + "core_id", core))
+        return 0;
+      cores.emplace(std::stol(package), std::stol(core));
+    }
+  }
+  return cores.size();
+}
+
+void readCaches(unsigned cpu, CPUTopology &topology) {
+  std::string dir =
+      "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cache/";
+  for (unsigned index = 0;; ++index) {
+    std::string cache = dir + "index" + std::to_string(index) + "/";
+    std::string level, type, size, lineSize;
+    if (!readLine(cache + "level", level) || !readLine(cache + "type", type) ||
+        !readLine(cache + "size", size))
+      return;
+    if (type == "Instruction")
+      continue;
+    switch (std::stoul(level)) {
+    case 1:
+      topology.l1CacheSize = parseSize(size);
+      if (readLine(cache + "coherency_line_size", lineSize))
+        topology.cacheLineSize = std::stoul(lineSize);
+      break;
+    case 2:
+      topology.l2CacheSize = parseSize(size);
+      break;
+    case 3:
+      topology.l3CacheSize = parseSize(size);
+      break;
+    }
+  }
+}
+
+std::vector<NumaNode> readNumaNodes(const std::set<unsigned> &allowed) {
+  std::vector<NumaNode> nodes;
+  const char *root = "/sys/devices/system/node";
+  DIR *dir = opendir(root);
+  if (!dir)
+    return nodes;
+  while (dirent *entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+        !std::isdigit(static_cast<unsigned char>(name[4])))
+      continue;
+    std::string list;
+    if (!readLine(std::string(root) + "/" + name + "/cpulist", list))
+      continue;
+    NumaNode node{static_cast<unsigned>(std::stoul(name.substr(4))), {}};
+    for (unsigned cpu : parseCPUList(list))
+      if (allowed.empty() || allowed.count(cpu))
+        node.cpus.push_back(cpu);
+    if (!node.cpus.empty())
+      nodes.push_back(std::move(node));
+  }
+  closedir(dir);
+  std::sort(nodes.begin(), nodes.end(),
+            [](const NumaNode &a, const NumaNode &b) { return a.id < b.id; });
+  return nodes;
+}
+#endif
+
+CPUTopology discoverTopology() {
+  CPUTopology topology;
+#ifdef __linux__
+  std::set<unsigned> allowed = getAllowedCPUs();
+  topology.nodes = readNumaNodes(allowed);
+  if (topology.nodes.empty() && !allowed.empty())
+    topology.nodes.push_back({0, {allowed.begin(), allowed.end()}});
+#endif
+  if (topology.nodes.empty()) {
+    NumaNode node{0, {}};
+    unsigned numCPUs = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned cpu = 0; cpu < numCPUs; ++cpu)
+      node.cpus.push_back(cpu);
+    topology.nodes.push_back(std::move(node));
+  }
+
+#ifdef __linux__
+  topology.numPhysicalCores = countPhysicalCores(topology.nodes);
+  readCaches(topology.nodes.front().cpus.front(), topology);
+#endif
+  if (topology.numPhysicalCores == 0)
+    topology.numPhysicalCores = topology.getNumCPUs();
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    topology.simdWidth = 512;
+  else if (__builtin_cpu_supports("avx"))
+    topology.simdWidth = 256;
+#endif
+  return topology;
+}
+
+} // namespace
+
+unsigned CPUTopology::getNumCPUs() const {
+  unsigned numCPUs = 0;
+  for (const NumaNode &node : nodes)
+    numCPUs += node.cpus.size();
+  return numCPUs;
+}
+
+unsigned CPUTopology::getThreadsPerCore() const {
+  return std::max(1u, (getNumCPUs() + numPhysicalCores - 1) / numPhysicalCores);
+}
+
+const CPUTopology &getCPUTopology() {
+  static const CPUTopology topology = discoverTopology();
+  return topology;
+}
+
+} // namespace triton_shared
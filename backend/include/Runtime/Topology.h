@@ -0,0 +1,60 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+//
+// Topology of the host CPU as seen by this process: the CPUs it may run on,
+// grouped by NUMA node, how they share physical cores, and the sizes of the
+// caches. Read from sysfs on Linux; elsewhere, or when sysfs is unavailable,
+// all CPUs are reported on a single node, each on its own core, and unknown
+// cache sizes as 0.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TRITON_SHARED_RUNTIME_TOPOLOGY_H
+#define TRITON_SHARED_RUNTIME_TOPOLOGY_H
+
+#include <cstdint>
+#include <vector>
+
+namespace triton_shared {
+
+struct NumaNode {
+  /// Operating system id of the node.
+  unsigned id;
+  /// Ids of the CPUs of the node the process may run on, in ascending order.
+  std::vector<unsigned> cpus;
+};
+
+struct CPUTopology {
+  /// Nodes with at least one CPU the process may run on, in ascending id
+  /// order. Never empty.
+  std::vector<NumaNode> nodes;
+
+  /// Number of physical cores the CPUs of `nodes` belong to.
+  unsigned numPhysicalCores = 0;
+
+  /// Per-core L1 data and L2 cache sizes and the size of one L3 cache, in
+  /// bytes, 0 if unknown.
+  uint64_t l1CacheSize = 0;
+  uint64_t l2CacheSize = 0;
+  uint64_t l3CacheSize = 0;
+  unsigned cacheLineSize = 64;
+
+  /// Width of the widest SIMD registers usable by kernels, in bits.
+  unsigned simdWidth = 128;
+
+  unsigned getNumCPUs() const;
+
+  /// Number of hardware threads sharing a physical core.
+  unsigned getThreadsPerCore() const;
+};
+
+/// Returns the topology of the host, discovered on the first call.
+const CPUTopology &getCPUTopology();
+
+} // namespace triton_shared
+
+#endif // TRITON_SHARED_RUNTIME_TOPOLOGY_H
@@ -0,0 +1,54 @@
+import os
+from concurrent.futures import ThreadPoolExecutor
+
+from triton.runtime.jit import JITFunction
+
+
+def _default_max_workers():
+    max_workers = int(os.getenv("TRITON_SHARED_COMPILE_THREADS", "0"))
+    if max_workers > 0:
+        return max_workers
+    return os.cpu_count() or 1
+
+
+def _unwrap(kernel):
+    # triton.autotune and triton.heuristics wrap the triton.jit function.
+    configs = getattr(kernel, "configs", None)
+    fn = kernel
+    while not isinstance(fn, JITFunction):
+        fn = fn.fn
+    return fn, configs
+
+
+def _config_kwargs(config):
+    if hasattr(config, "all_kwargs"):
+        return config.all_kwargs()
+    return dict(config.kwargs, num_warps=config.num_warps, num_stages=config.num_stages)
+
+
+def precompile(kernel, *args, configs=None, grid=(1, ), max_workers=None, **kwargs):
+    """Compiles `kernel` for every config concurrently and fills the cache.
+
+    `kernel` is a `triton.jit` function or a `triton.autotune`d kernel, whose
+    configs are used if `configs` isn't given. `args` and `kwargs` are the launch
+    arguments the kernel is specialized for, nothing is launched. At most
+    `max_workers` configs are compiled at a time, which defaults to
+    TRITON_SHARED_COMPILE_THREADS or the number of CPUs.
+
+    Returns the compiled kernels in the order of the configs.
+    """
+    fn, autotune_configs = _unwrap(kernel)
+    if configs is None:
+        configs = autotune_configs
+    if not configs:
+        return [fn.warmup(*args, grid=grid, **kwargs)]
+    if max_workers is None:
+        max_workers = _default_max_workers()
+
+    def compile_config(config):
+        return fn.warmup(*args, grid=grid, **kwargs, **_config_kwargs(config))
+
+    # The lowering releases the GIL while the pass pipelines, llc and the
+    # external tools run, so configs actually compile in parallel.
+    with ThreadPoolExecutor(max_workers=max_workers) as pool:
+        return list(pool.map(compile_config, configs))
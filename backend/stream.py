@@ -0,0 +1,32 @@
+import threading
+from contextlib import contextmanager
+
+from triton._C.libtriton import triton_shared
+
+# Streams and events of the CPU runtime, see backend/include/Runtime/Stream.h.
+Stream = triton_shared.runtime.Stream
+Event = triton_shared.runtime.Event
+
+_current = threading.local()
+
+
+def current_stream():
+    """Returns the stream kernels are launched on by the calling thread, or
+    None when launches are synchronous."""
+    return getattr(_current, "stream", None)
+
+
+@contextmanager
+def stream(s):
+    """Launches the kernels of the enclosed block asynchronously on `s`.
+
+    Launches return as soon as the kernel is enqueued; the kernel arguments are
+    kept alive until it has run. Call `s.synchronize()` before reading results
+    on the host. Passing None makes launches synchronous again.
+    """
+    previous = current_stream()
+    _current.stream = s
+    try:
+        yield s
+    finally:
+        _current.stream = previous
@@ -1140,33 +1140,32 @@ struct MatmulConverter : public OpConversionPattern<triton::DotOp> {
     auto dstType = cast<RankedTensorType>(op.getType());
     auto elementType = dstType.getElementType();
     bool integers = elementType.isInteger();
-    bool skipC = isZeroTensor(opc, integers);
-    auto init =
-        rewriter.create<tensor::EmptyOp>(loc, dstType.getShape(), elementType);
-    TypedAttr constantAttr = integers ?
-      static_cast<TypedAttr>(rewriter.getIntegerAttr(elementType, 0)) :
-      static_cast<TypedAttr>(rewriter.getFloatAttr(elementType, 0));
-
-    auto zero = rewriter.create<mlir::arith::ConstantOp>(
-        op.getLoc(), elementType, constantAttr);
-
-    auto zeroes =
-        rewriter.create<linalg::FillOp>(loc, ValueRange{zero}, ValueRange{init})
-            .result();
+
+    // linalg.matmul accumulates into its init, so C is the init unless it is
+    // known to be zero. In the K loop of a matmul kernel C is the accumulator
+    // carried by the loop, which then bufferizes in place instead of being
+    // reallocated and added to on every iteration.
+    Value init = opc;
+    if (isZeroTensor(opc, integers)) {
+      auto empty = rewriter.create<tensor::EmptyOp>(loc, dstType.getShape(),
+                                                    elementType);
+      TypedAttr constantAttr =
+          integers
+              ? static_cast<TypedAttr>(rewriter.getIntegerAttr(elementType, 0))
+              : static_cast<TypedAttr>(rewriter.getFloatAttr(elementType, 0));
+      auto zero = rewriter.create<mlir::arith::ConstantOp>(
+          op.getLoc(), elementType, constantAttr);
+      init = rewriter
+                 .create<linalg::FillOp>(loc, ValueRange{zero},
+                                         ValueRange{empty})
+                 .result();
+    }
 
     auto res = rewriter
                    .create<linalg::MatmulOp>(loc, ValueRange{opa, opb},
-                                             ValueRange{zeroes})
+                                             ValueRange{init})
                    .getResult(0);
 
-    if (!skipC) {
-      if (integers) {
-        res = rewriter.create<arith::AddIOp>(loc, opc, res);
-      } else {
-        res = rewriter.create<arith::AddFOp>(loc, opc, res);
-      }
-    }
-
     rewriter.replaceOp(op, res);
     return success();
   }
@@ -0,0 +1,85 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TRITON_SHARED_PIPELINES_PIPELINES_H
+#define TRITON_SHARED_PIPELINES_PIPELINES_H
+
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Pass/PassOptions.h"
+
+#include <string>
+
+namespace mlir {
+namespace triton {
+
+enum class CPUBufferizationMode {
+  // Analyze the module and bufferize in place wherever possible.
+  OneShot,
+  // Skip the analysis and copy every buffer that is written to. Faster to
+  // compile, slower to run.
+  CopyBeforeWrite,
+};
+
+struct CPUPipelineOptions : public PassPipelineOptions<CPUPipelineOptions> {
+  PassOptions::Option<bool> fromTTIR{
+      *this, "from-ttir",
+      llvm::cl::desc("Lower a ttir module with triton-to-linalg-experimental "
+                     "first"),
+      llvm::cl::init(false)};
+  PassOptions::Option<bool> gridAsLoop{
+      *this, "grid-as-loop",
+      llvm::cl::desc("Run a range of programs of the launch grid in a loop "
+                     "inside each kernel (see triton-shared-grid-to-loop)"),
+      llvm::cl::init(false)};
+  PassOptions::Option<bool> matmulLibrary{
+      *this, "matmul-library",
+      llvm::cl::desc("Compute linalg.matmul ops with the packed matrix "
+                     "multiplication of the CPU runtime (see "
+                     "triton-shared-matmul-to-library)"),
+      llvm::cl::init(false)};
+  PassOptions::Option<bool> vectorize{
+      *this, "vectorize",
+      llvm::cl::desc("Vectorize the innermost loops lowered from linalg ops"),
+      llvm::cl::init(false)};
+  PassOptions::Option<int64_t> vectorSize{
+      *this, "vector-size",
+      llvm::cl::desc("Number of elements per vector when vectorizing"),
+      llvm::cl::init(8)};
+  PassOptions::ListOption<int64_t> tileSizes{
+      *this, "tile-sizes",
+      llvm::cl::desc("Tile sizes of the loop nests lowered from linalg ops, "
+                     "outermost loop first")};
+  PassOptions::Option<CPUBufferizationMode> bufferizationMode{
+      *this, "bufferization-mode", llvm::cl::desc("How to bufferize tensors"),
+      llvm::cl::init(CPUBufferizationMode::OneShot),
+      llvm::cl::values(
+          clEnumValN(CPUBufferizationMode::OneShot, "one-shot",
+                     "One-Shot Bufferize with in-place analysis"),
+          clEnumValN(CPUBufferizationMode::CopyBeforeWrite,
+                     "copy-before-write",
+                     "One-Shot Bufferize copying every written buffer"))};
+  PassOptions::Option<std::string> targetCPU{
+      *this, "target-cpu",
+      llvm::cl::desc("CPU the kernel functions are tuned for, e.g. 'skylake'")};
+  PassOptions::Option<std::string> targetFeatures{
+      *this, "target-features",
+      llvm::cl::desc("LLVM target features enabled in the kernel functions, "
+                     "e.g. '+avx2,+fma'")};
+};
+
+// Adds the lowering from ttsharedir to the LLVM dialect used by the CPU
+// backend to `pm`. Tiling and vectorization are added by name, so the upstream
+// affine passes must be registered.
+void buildCPUPipeline(OpPassManager &pm, const CPUPipelineOptions &options);
+
+// Registers the lowering as the `triton-shared-cpu-pipeline` pass pipeline.
+void registerCPUPipeline();
+
+} // namespace triton
+} // namespace mlir
+
+#endif // TRITON_SHARED_PIPELINES_PIPELINES_H
@@ -0,0 +1,27 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TRITON_SHARED_TRANSFORMS_PASSES_H
+#define TRITON_SHARED_TRANSFORMS_PASSES_H
+
+#include "triton-shared/Transforms/ExpandMemRefCopy.h"
+#include "triton-shared/Transforms/FuseElementwise.h"
+#include "triton-shared/Transforms/GridToLoop.h"
+#include "triton-shared/Transforms/MatmulToLibrary.h"
+#include "triton-shared/Transforms/TileAndFuse.h"
+#include "triton-shared/Transforms/VectorizeLinalg.h"
+
+namespace mlir {
+namespace triton {
+
+#define GEN_PASS_REGISTRATION
+#include "triton-shared/Transforms/Passes.h.inc"
+
+} // namespace triton
+} // namespace mlir
+
+#endif
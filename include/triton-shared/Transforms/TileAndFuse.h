@@ -0,0 +1,22 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TRITON_SHARED_TRANSFORMS_TILEANDFUSE_H
+#define TRITON_SHARED_TRANSFORMS_TILEANDFUSE_H
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/Pass.h"
+
+namespace mlir {
+namespace triton {
+
+std::unique_ptr<OperationPass<ModuleOp>> createTileAndFusePass();
+
+} // namespace triton
+} // namespace mlir
+
+#endif // TRITON_SHARED_TRANSFORMS_TILEANDFUSE_H
@@ -0,0 +1,176 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+
+#include "triton-shared/Conversion/TritonToLinalgExperimental/TritonToLinalgExperimental.h"
+#include "triton-shared/Pipelines/Pipelines.h"
+#include "triton-shared/Transforms/ExpandMemRefCopy.h"
+#include "triton-shared/Transforms/GridToLoop.h"
+#include "triton-shared/Transforms/MatmulToLibrary.h"
+
+#include "mlir/Conversion/Passes.h"
+#include "mlir/Dialect/Bufferization/Transforms/OneShotAnalysis.h"
+#include "mlir/Dialect/Bufferization/Transforms/Passes.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/Linalg/Passes.h"
+#include "mlir/Dialect/MemRef/Transforms/Passes.h"
+#include "mlir/Pass/PassRegistry.h"
+#include "mlir/Transforms/Passes.h"
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/ErrorHandling.h"
+
+using namespace mlir;
+using namespace triton;
+
+namespace {
+
+// Attaches the target CPU and features to the kernel functions. The
+// translation to LLVM IR turns them into "target-cpu" and "target-features"
+// function attributes, which code generation honors.
+class SetTargetAttributesPass
+    : public PassWrapper<SetTargetAttributesPass, OperationPass<ModuleOp>> {
+public:
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(SetTargetAttributesPass)
+
+  SetTargetAttributesPass(StringRef cpu, StringRef features)
+      : cpu(cpu), features(features) {}
+
+  StringRef getArgument() const final {
+    return "triton-shared-set-target-attributes";
+  }
+
+  void runOnOperation() override {
+    MLIRContext *context = &getContext();
+    getOperation().walk([&](LLVM::LLVMFuncOp func) {
+      if (func.isExternal())
+        return;
+      if (!cpu.empty())
+        func.setTargetCpuAttr(StringAttr::get(context, cpu));
+      if (!features.empty())
+        func.setTargetFeaturesAttr(
+            LLVM::TargetFeaturesAttr::get(context, features));
+    });
+  }
+
+private:
+  std::string cpu;
+  std::string features;
+};
+
+void addPipeline(OpPassManager &pm, StringRef pipeline) {
+  std::string error;
+  llvm::raw_string_ostream os(error);
+  if (failed(parsePassPipeline(pipeline, pm, os)))
+    llvm::report_fatal_error(llvm::Twine("triton-shared-cpu-pipeline: ") +
+                             os.str());
+}
+
+} // namespace
+
+void triton::buildCPUPipeline(OpPassManager &pm,
+                              const CPUPipelineOptions &options) {
+  if (options.fromTTIR)
+    pm.addPass(createTritonToLinalgExperimentalPass());
+  if (options.gridAsLoop)
+    pm.addPass(createGridToLoopPass());
+
+  // Tiling and vectorization work on the affine loops of buffer-semantics
+  // linalg ops, so in that case linalg ops are lowered after bufferization.
+  // Otherwise they go through the scf lowering below.
+  bool optimizeLoops = options.vectorize || !options.tileSizes.empty();
+  if (!optimizeLoops)
+    pm.addPass(createConvertLinalgToAffineLoopsPass());
+
+  // Note: eliminate-empty-tensors fails when there are multiple func.return
+  // ops in a single kernel which are the results of early returns.
+  // See python/examples/test_early_return.py for examples.
+  pm.addPass(bufferization::createEmptyTensorToAllocTensorPass());
+  bufferization::OneShotBufferizationOptions bufferizationOptions;
+  // Loop-carried tensors updated in place, such as the accumulator of a
+  // tt.dot in a K loop (see MatmulConverter), keep the buffer of the loop
+  // init. Loops yielding a new tensor get a new buffer per iteration.
+  bufferizationOptions.allowReturnAllocsFromLoops = true;
+  bufferizationOptions.copyBeforeWrite =
+      options.bufferizationMode == CPUBufferizationMode::CopyBeforeWrite;
+  pm.addPass(bufferization::createOneShotBufferizePass(bufferizationOptions));
+
+  // With grid-as-loop, inline the program body into the loop over the
+  // program range once every function is bufferized. The memref descriptors
+  // of the kernel arguments are then unpacked once per range rather than once
+  // per program.
+  if (options.gridAsLoop) {
+    pm.addPass(createInlinerPass());
+    pm.addPass(createLoopInvariantCodeMotionPass());
+  }
+
+  // Matrix multiplications, i.e. tt.dot ops, become calls to the packed
+  // kernel of the runtime before linalg ops are lowered to loops.
+  if (options.matmulLibrary)
+    pm.addPass(createMatmulToLibraryPass());
+
+  // Strided copies, e.g. of masked loads, become inline loops rather than
+  // calls to the memrefCopy runtime function.
+  pm.addPass(createExpandMemRefCopyPass());
+
+  if (optimizeLoops) {
+    pm.addPass(createConvertLinalgToAffineLoopsPass());
+    OpPassManager &funcPM = pm.nest<func::FuncOp>();
+    if (!options.tileSizes.empty()) {
+      SmallVector<std::string> tileSizes;
+      for (int64_t size : options.tileSizes)
+        tileSizes.push_back(std::to_string(size));
+      addPipeline(funcPM, "affine-loop-tile{tile-sizes=" +
+                              llvm::join(tileSizes, ",") + "}");
+    }
+    if (options.vectorize) {
+      addPipeline(funcPM, "affine-super-vectorize{virtual-vector-size=" +
+                              std::to_string(options.vectorSize) + "}");
+    }
+  }
+
+  // Vector ops come from the loop vectorizer above or from ttsharedir that
+  // was vectorized before bufferization (see triton-shared-vectorize-linalg).
+  pm.addPass(createConvertVectorToSCFPass());
+
+  pm.addPass(createLowerAffinePass());
+  pm.addPass(createConvertLinalgToLoopsPass());
+  pm.addPass(memref::createExpandStridedMetadataPass());
+  pm.addPass(createConvertSCFToCFPass());
+  pm.addPass(createArithToLLVMConversionPass());
+  pm.addPass(createConvertMathToLLVMPass());
+  pm.addPass(createConvertComplexToLLVMPass());
+  pm.addPass(createConvertVectorToLLVMPass());
+  pm.addPass(createConvertIndexToLLVMPass());
+  pm.addPass(memref::createExpandOpsPass());
+  // Kernels allocate through the CPU runtime, which binds the generic
+  // allocation functions to mlirAlloc and friends (see Runtime/Memory.h).
+  FinalizeMemRefToLLVMConversionPassOptions memrefToLLVMOptions;
+  memrefToLLVMOptions.useGenericFunctions = true;
+  pm.addPass(createFinalizeMemRefToLLVMConversionPass(memrefToLLVMOptions));
+  pm.addPass(createConvertFuncToLLVMPass());
+  pm.addPass(createConvertControlFlowToLLVMPass());
+  // Lowering memrefs creates more affine.apply ops.
+  // Lowering these affine ops again creates further arith ops,
+  // so we have to run these two passes again here.
+  pm.addPass(createLowerAffinePass());
+  pm.addPass(createArithToLLVMConversionPass());
+  // Remove all unrealized casts created
+  pm.addPass(createReconcileUnrealizedCastsPass());
+
+  if (!options.targetCPU.empty() || !options.targetFeatures.empty())
+    pm.addPass(std::make_unique<SetTargetAttributesPass>(
+        options.targetCPU, options.targetFeatures));
+}
+
+void triton::registerCPUPipeline() {
+  PassPipelineRegistration<CPUPipelineOptions>(
+      "triton-shared-cpu-pipeline",
+      "Lower ttsharedir, or ttir with from-ttir, to the LLVM dialect for the "
+      "CPU backend",
+      buildCPUPipeline);
+}
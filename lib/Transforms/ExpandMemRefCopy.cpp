@@ -0,0 +1,105 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+
+#include "triton-shared/Transforms/ExpandMemRefCopy.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/MemRef/Utils/MemRefUtils.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/IR/Builders.h"
+
+#include "llvm/ADT/SmallVector.h"
+
+using namespace mlir;
+using namespace triton;
+
+#define GEN_PASS_CLASSES
+#include "triton-shared/Transforms/Passes.h.inc"
+
+namespace {
+
+// Copies that FinalizeMemRefToLLVM lowers to llvm.memcpy.
+bool isContiguous(MemRefType type) {
+  return type.getLayout().isIdentity() ||
+         memref::isStaticShapeAndContiguousRowMajor(type);
+}
+
+bool hasStaticInnerStride(MemRefType type) {
+  if (type.getRank() == 0)
+    return true;
+  SmallVector<int64_t> strides;
+  int64_t offset;
+  return succeeded(type.getStridesAndOffset(strides, offset)) &&
+         !ShapedType::isDynamic(strides.back());
+}
+
+class ExpandMemRefCopyPass
+    : public ExpandMemRefCopyBase<ExpandMemRefCopyPass> {
+
+public:
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<arith::ArithDialect, memref::MemRefDialect,
+                    scf::SCFDialect>();
+  }
+
+  void runOnOperation() override {
+    SmallVector<memref::CopyOp> copies;
+    getOperation().walk([&](memref::CopyOp copy) {
+      auto srcType = dyn_cast<MemRefType>(copy.getSource().getType());
+      auto dstType = dyn_cast<MemRefType>(copy.getTarget().getType());
+      if (!srcType || !dstType)
+        return;
+      if (isContiguous(srcType) && isContiguous(dstType))
+        return;
+      if (hasStaticInnerStride(srcType) && hasStaticInnerStride(dstType))
+        copies.push_back(copy);
+    });
+    for (memref::CopyOp copy : copies)
+      expand(copy);
+  }
+
+private:
+  // Copies element by element in a loop nest over the shape of the source,
+  // innermost dimension last, so that the innermost loop has a known stride
+  // on both sides and can be vectorized by LLVM.
+  void expand(memref::CopyOp copy) {
+    OpBuilder builder(copy);
+    Location loc = copy.getLoc();
+    Value src = copy.getSource();
+    Value dst = copy.getTarget();
+    auto srcType = cast<MemRefType>(src.getType());
+
+    SmallVector<Value> lbs, ubs, steps;
+    Value zero = builder.create<arith::ConstantIndexOp>(loc, 0);
+    Value one = builder.create<arith::ConstantIndexOp>(loc, 1);
+    for (int64_t dim = 0; dim < srcType.getRank(); ++dim) {
+      lbs.push_back(zero);
+      ubs.push_back(
+          srcType.isDynamicDim(dim)
+              ? builder.create<memref::DimOp>(loc, src, dim).getResult()
+              : builder
+                    .create<arith::ConstantIndexOp>(loc,
+                                                    srcType.getDimSize(dim))
+                    .getResult());
+      steps.push_back(one);
+    }
+
+    scf::buildLoopNest(builder, loc, lbs, ubs, steps,
+                       [&](OpBuilder &b, Location loc, ValueRange ivs) {
+                         Value value = b.create<memref::LoadOp>(loc, src, ivs);
+                         b.create<memref::StoreOp>(loc, value, dst, ivs);
+                       });
+    copy.erase();
+  }
+};
+} // namespace
+
+std::unique_ptr<OperationPass<ModuleOp>>
+triton::createExpandMemRefCopyPass() {
+  return std::make_unique<ExpandMemRefCopyPass>();
+}
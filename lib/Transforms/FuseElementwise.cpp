@@ -0,0 +1,96 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+
+#include "triton-shared/Transforms/FuseElementwise.h"
+
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Linalg/IR/Linalg.h"
+#include "mlir/Dialect/Linalg/Transforms/Transforms.h"
+#include "mlir/Dialect/Tensor/IR/Tensor.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+
+#include "llvm/ADT/SmallVector.h"
+
+using namespace mlir;
+using namespace triton;
+
+#define GEN_PASS_CLASSES
+#include "triton-shared/Transforms/Passes.h.inc"
+
+namespace {
+
+// Producers a consumer broadcasts are recomputed for every broadcast element,
+// so only those with at most this many operations are fused.
+constexpr unsigned kMaxRecomputedOps = 1;
+
+unsigned getNumBodyOps(linalg::GenericOp op) {
+  // Everything but the terminator.
+  return op.getBody()->getOperations().size() - 1;
+}
+
+// Splats only read by generics are fused into them like any other producer.
+bool isFusableFill(linalg::FillOp fill) {
+  return fill.hasPureTensorSemantics() &&
+         llvm::all_of(fill->getUses(), [](OpOperand &use) {
+           auto generic = dyn_cast<linalg::GenericOp>(use.getOwner());
+           return generic && generic.isDpsInput(&use);
+         });
+}
+
+class FuseElementwisePass : public FuseElementwiseBase<FuseElementwisePass> {
+
+public:
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<affine::AffineDialect, arith::ArithDialect,
+                    linalg::LinalgDialect, tensor::TensorDialect>();
+  }
+
+  void runOnOperation() override {
+    auto moduleOp = getOperation();
+    MLIRContext *context = &getContext();
+
+    SmallVector<linalg::FillOp> fills;
+    moduleOp.walk([&](linalg::FillOp fill) {
+      if (isFusableFill(fill))
+        fills.push_back(fill);
+    });
+    IRRewriter rewriter(context);
+    for (linalg::FillOp fill : fills) {
+      rewriter.setInsertionPoint(fill);
+      (void)linalg::generalizeNamedOp(rewriter, fill);
+    }
+
+    RewritePatternSet patterns(context);
+    linalg::populateElementwiseOpsFusionPatterns(
+        patterns,
+        [this](OpOperand *fusedOperand) { return shouldFuse(fusedOperand); });
+    linalg::populateEraseUnusedOperandsAndResultsPatterns(patterns);
+    linalg::GenericOp::getCanonicalizationPatterns(patterns, context);
+    if (failed(applyPatternsGreedily(moduleOp, std::move(patterns))))
+      signalPassFailure();
+  }
+
+private:
+  bool shouldFuse(OpOperand *fusedOperand) {
+    auto producer = fusedOperand->get().getDefiningOp<linalg::GenericOp>();
+    auto consumer = dyn_cast<linalg::GenericOp>(fusedOperand->getOwner());
+    if (!producer || !consumer)
+      return false;
+    unsigned producerOps = getNumBodyOps(producer);
+    if (producerOps + getNumBodyOps(consumer) > maxOps)
+      return false;
+    AffineMap consumerMap = consumer.getMatchingIndexingMap(fusedOperand);
+    return consumerMap.isPermutation() || producerOps <= kMaxRecomputedOps;
+  }
+};
+} // namespace
+
+std::unique_ptr<OperationPass<ModuleOp>> triton::createFuseElementwisePass() {
+  return std::make_unique<FuseElementwisePass>();
+}
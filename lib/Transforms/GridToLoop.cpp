@@ -0,0 +1,150 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+
+#include "triton-shared/Transforms/GridToLoop.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/IR/Builders.h"
+
+#include "llvm/ADT/SmallVector.h"
+
+using namespace mlir;
+using namespace triton;
+
+#define GEN_PASS_CLASSES
+#include "triton-shared/Transforms/Passes.h.inc"
+
+namespace {
+
+// gridX, gridY, gridZ, pidX, pidY, pidZ; see addProgramInfo in
+// TritonArithToLinalgPass.cpp.
+constexpr unsigned kProgramInfoArgCount = 6;
+
+// Runtime functions bracketing each program, which release the buffers the
+// program allocated; see Runtime/Memory.h.
+constexpr StringLiteral kBeginProgram = "triton_shared_begin_program";
+constexpr StringLiteral kEndProgram = "triton_shared_end_program";
+
+bool hasProgramInfo(func::FuncOp func) {
+  if (func.isExternal() || func.isPrivate())
+    return false;
+  ArrayRef<Type> inputs = func.getFunctionType().getInputs();
+  if (inputs.size() < kProgramInfoArgCount ||
+      !func.getFunctionType().getResults().empty())
+    return false;
+  return llvm::all_of(inputs.take_back(kProgramInfoArgCount),
+                      [](Type type) { return type.isInteger(32); });
+}
+
+class GridToLoopPass : public GridToLoopBase<GridToLoopPass> {
+
+public:
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<arith::ArithDialect, func::FuncDialect,
+                    LLVM::LLVMDialect, scf::SCFDialect>();
+  }
+
+  void runOnOperation() override {
+    auto moduleOp = getOperation();
+    SmallVector<func::FuncOp> kernels;
+    for (auto func : moduleOp.getOps<func::FuncOp>()) {
+      if (hasProgramInfo(func))
+        kernels.push_back(func);
+    }
+    for (auto func : kernels)
+      wrapInGridLoop(func);
+  }
+
+private:
+  func::FuncOp getOrInsertRuntimeFunction(StringRef name) {
+    ModuleOp moduleOp = getOperation();
+    if (auto func = moduleOp.lookupSymbol<func::FuncOp>(name))
+      return func;
+
+    OpBuilder builder = OpBuilder::atBlockBegin(moduleOp.getBody());
+    auto func = builder.create<func::FuncOp>(
+        moduleOp.getLoc(), name, FunctionType::get(&getContext(), {}, {}));
+    func.setPrivate();
+    return func;
+  }
+
+  void wrapInGridLoop(func::FuncOp program) {
+    MLIRContext *context = &getContext();
+    Location loc = program.getLoc();
+    std::string name = program.getSymName().str();
+    ArrayRef<Type> programInputs = program.getFunctionType().getInputs();
+    unsigned numKernelArgs = programInputs.size() - kProgramInfoArgCount;
+
+    // The program body becomes an internal function so that it does not
+    // clash with the kernel entry and can be inlined into the loop.
+    program.setSymName(name + "_program");
+    program.setPrivate();
+    program->setAttr("llvm.linkage",
+                     LLVM::LinkageAttr::get(context, LLVM::Linkage::Internal));
+
+    auto i32Type = IntegerType::get(context, 32);
+    auto i64Type = IntegerType::get(context, 64);
+    SmallVector<Type> inputs(programInputs.take_front(numKernelArgs));
+    inputs.append(3, i32Type);
+    inputs.append(2, i64Type);
+
+    OpBuilder builder(program);
+    auto kernel = builder.create<func::FuncOp>(
+        loc, name, FunctionType::get(context, inputs, {}));
+    for (unsigned i = 0; i < numKernelArgs; ++i)
+      kernel.setArgAttrs(i, program.getArgAttrs(i));
+
+    Block *entry = kernel.addEntryBlock();
+    builder.setInsertionPointToStart(entry);
+    ValueRange args = entry->getArguments();
+    ValueRange kernelArgs = args.take_front(numKernelArgs);
+    ValueRange grid = args.slice(numKernelArgs, 3);
+
+    auto toIndex = [&](Value value) -> Value {
+      return builder.create<arith::IndexCastOp>(loc, builder.getIndexType(),
+                                                value);
+    };
+    Value gridY = toIndex(grid[1]);
+    Value gridZ = toIndex(grid[2]);
+    Value begin = toIndex(args[numKernelArgs + 3]);
+    Value end = toIndex(args[numKernelArgs + 4]);
+    Value one = builder.create<arith::ConstantIndexOp>(loc, 1);
+    func::FuncOp beginProgram = getOrInsertRuntimeFunction(kBeginProgram);
+    func::FuncOp endProgram = getOrInsertRuntimeFunction(kEndProgram);
+
+    builder.create<scf::ParallelOp>(
+        loc, ValueRange{begin}, ValueRange{end}, ValueRange{one},
+        [&](OpBuilder &b, Location loc, ValueRange ivs) {
+          // Program ids are linearized with z varying fastest, matching
+          // GridExecutor::delinearize.
+          Value z = b.create<arith::RemUIOp>(loc, ivs[0], gridZ);
+          Value xy = b.create<arith::DivUIOp>(loc, ivs[0], gridZ);
+          Value y = b.create<arith::RemUIOp>(loc, xy, gridY);
+          Value x = b.create<arith::DivUIOp>(loc, xy, gridY);
+
+          SmallVector<Value> callArgs = llvm::to_vector(kernelArgs);
+          callArgs.append(grid.begin(), grid.end());
+          for (Value pid : {x, y, z})
+            callArgs.push_back(b.create<arith::IndexCastOp>(loc, i32Type, pid));
+          // Kernels are lowered without deallocations; without a scope per
+          // program, the buffers of every program of the range would stay
+          // alive until the range ends.
+          b.create<func::CallOp>(loc, beginProgram, ValueRange{});
+          b.create<func::CallOp>(loc, program, callArgs);
+          b.create<func::CallOp>(loc, endProgram, ValueRange{});
+        });
+    builder.create<func::ReturnOp>(loc);
+  }
+};
+} // namespace
+
+std::unique_ptr<OperationPass<ModuleOp>> triton::createGridToLoopPass() {
+  return std::make_unique<GridToLoopPass>();
+}
@@ -0,0 +1,145 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+
+#include "triton-shared/Transforms/MatmulToLibrary.h"
+
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/Linalg/IR/Linalg.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/IR/AffineMap.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/SymbolTable.h"
+
+#include "llvm/ADT/SmallVector.h"
+
+using namespace mlir;
+using namespace triton;
+
+#define GEN_PASS_CLASSES
+#include "triton-shared/Transforms/Passes.h.inc"
+
+namespace {
+
+// Name of the runtime function multiplying operands of `type`, see
+// CRunnerUtils.h, or an empty string if there is none.
+StringRef getLibraryFunction(Type type) {
+  if (type.isF32())
+    return "triton_shared_matmul_f32";
+  if (type.isF16())
+    return "triton_shared_matmul_f16_f32";
+  if (type.isBF16())
+    return "triton_shared_matmul_bf16_f32";
+  return "";
+}
+
+// (m, k), (k, n) and (m, n): no transposed or broadcast operand.
+bool hasDefaultIndexingMaps(linalg::MatmulOp matmul) {
+  MLIRContext *context = matmul.getContext();
+  AffineExpr m, n, k;
+  bindDims(context, m, n, k);
+  SmallVector<AffineMap> expected = {AffineMap::get(3, 0, {m, k}, context),
+                                     AffineMap::get(3, 0, {k, n}, context),
+                                     AffineMap::get(3, 0, {m, n}, context)};
+  return matmul.getIndexingMapsArray() == ArrayRef<AffineMap>(expected);
+}
+
+bool isStrided(MemRefType type) {
+  SmallVector<int64_t> strides;
+  int64_t offset;
+  return succeeded(type.getStridesAndOffset(strides, offset));
+}
+
+bool isSupported(linalg::MatmulOp matmul) {
+  if (!matmul.hasPureBufferSemantics() || !hasDefaultIndexingMaps(matmul))
+    return false;
+  auto aType = dyn_cast<MemRefType>(matmul.getDpsInputs()[0].getType());
+  auto bType = dyn_cast<MemRefType>(matmul.getDpsInputs()[1].getType());
+  auto cType = dyn_cast<MemRefType>(matmul.getDpsInits()[0].getType());
+  if (!aType || !bType || !cType || !isStrided(aType) || !isStrided(bType) ||
+      !isStrided(cType))
+    return false;
+  return aType.getElementType() == bType.getElementType() &&
+         !getLibraryFunction(aType.getElementType()).empty() &&
+         cType.getElementType().isF32();
+}
+
+// memref<?x?xT, strided<[?, ?], offset: ?>>, to which any 2-D memref with a
+// strided layout can be cast.
+MemRefType getDynamicMemRefType(Type elementType) {
+  MLIRContext *context = elementType.getContext();
+  int64_t dynamic = ShapedType::kDynamic;
+  return MemRefType::get(
+      {dynamic, dynamic}, elementType,
+      StridedLayoutAttr::get(context, dynamic, {dynamic, dynamic}));
+}
+
+class MatmulToLibraryPass
+    : public MatmulToLibraryBase<MatmulToLibraryPass> {
+
+public:
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<func::FuncDialect, LLVM::LLVMDialect,
+                    memref::MemRefDialect>();
+  }
+
+  void runOnOperation() override {
+    SmallVector<linalg::MatmulOp> matmuls;
+    getOperation().walk([&](linalg::MatmulOp matmul) {
+      if (isSupported(matmul))
+        matmuls.push_back(matmul);
+    });
+    for (linalg::MatmulOp matmul : matmuls)
+      replaceWithCall(matmul);
+  }
+
+private:
+  func::FuncOp getOrInsertFunction(Type elementType) {
+    ModuleOp moduleOp = getOperation();
+    StringRef name = getLibraryFunction(elementType);
+    if (auto func = moduleOp.lookupSymbol<func::FuncOp>(name))
+      return func;
+
+    MLIRContext *context = &getContext();
+    MemRefType operandType = getDynamicMemRefType(elementType);
+    MemRefType resultType = getDynamicMemRefType(Float32Type::get(context));
+    auto functionType = FunctionType::get(
+        context, {operandType, operandType, resultType}, {});
+    OpBuilder builder = OpBuilder::atBlockBegin(moduleOp.getBody());
+    auto func =
+        builder.create<func::FuncOp>(moduleOp.getLoc(), name, functionType);
+    func.setPrivate();
+    func->setAttr(LLVM::LLVMDialect::getEmitCWrapperAttrName(),
+                  UnitAttr::get(context));
+    return func;
+  }
+
+  void replaceWithCall(linalg::MatmulOp matmul) {
+    Value a = matmul.getDpsInputs()[0];
+    func::FuncOp func =
+        getOrInsertFunction(cast<MemRefType>(a.getType()).getElementType());
+
+    OpBuilder builder(matmul);
+    SmallVector<Value> operands;
+    for (auto [operand, type] :
+         llvm::zip(matmul->getOperands(), func.getArgumentTypes())) {
+      operands.push_back(
+          operand.getType() == type
+              ? operand
+              : builder.create<memref::CastOp>(matmul.getLoc(), type, operand)
+                    .getResult());
+    }
+    builder.create<func::CallOp>(matmul.getLoc(), func, operands);
+    matmul.erase();
+  }
+};
+} // namespace
+
+std::unique_ptr<OperationPass<ModuleOp>>
+triton::createMatmulToLibraryPass() {
+  return std::make_unique<MatmulToLibraryPass>();
+}
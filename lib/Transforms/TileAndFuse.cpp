@@ -0,0 +1,204 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+
+#include "triton-shared/Transforms/TileAndFuse.h"
+
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Linalg/IR/Linalg.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/SCF/Transforms/TileUsingInterface.h"
+#include "mlir/Dialect/Tensor/IR/Tensor.h"
+#include "mlir/IR/PatternMatch.h"
+
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallVector.h"
+
+using namespace mlir;
+using namespace triton;
+
+#define GEN_PASS_CLASSES
+#include "triton-shared/Transforms/Passes.h.inc"
+
+namespace {
+
+// Tiles never split the innermost parallel loop below this many iterations,
+// so the rows of a tile stay long enough to vectorize.
+constexpr int64_t kMinInnerTileSize = 16;
+
+bool isTileable(linalg::LinalgOp op) {
+  return op.hasPureTensorSemantics() && op.getNumLoops() > 0 &&
+         !op.hasDynamicShape();
+}
+
+// Returns the linalg op producing `operand` if it can be fused into the tile
+// loops of the owner of `operand`: a tileable op in the same block whose
+// result has no other use.
+linalg::LinalgOp getFusableProducer(OpOperand &operand) {
+  auto producer = operand.get().getDefiningOp<linalg::LinalgOp>();
+  if (!producer || !isTileable(producer) || !operand.get().hasOneUse() ||
+      producer->getBlock() != operand.getOwner()->getBlock())
+    return nullptr;
+  return producer;
+}
+
+// Collects `root` and the ops fused into its tile loops, consumers before
+// their producers.
+void collectChain(linalg::LinalgOp root,
+                  llvm::SetVector<Operation *> &chain) {
+  chain.insert(root);
+  for (size_t i = 0; i < chain.size(); ++i)
+    for (OpOperand &operand : chain[i]->getOpOperands())
+      if (linalg::LinalgOp producer = getFusableProducer(operand))
+        chain.insert(producer);
+}
+
+int64_t getElementBytes(Type type) {
+  Type elementType = getElementTypeOrSelf(type);
+  if (!elementType.isIntOrFloat())
+    return 8;
+  return (elementType.getIntOrFloatBitWidth() + 7) / 8;
+}
+
+// Shape of the slice of an operand with indexing map `map` and shape `shape`
+// read by a tile with loop sizes `loopTile`.
+SmallVector<int64_t> getOperandTile(AffineMap map, ArrayRef<int64_t> loopTile,
+                                    ArrayRef<int64_t> shape) {
+  SmallVector<int64_t> tile(shape);
+  for (auto [i, expr] : llvm::enumerate(map.getResults()))
+    if (auto dim = dyn_cast<AffineDimExpr>(expr))
+      tile[i] = loopTile[dim.getPosition()];
+  return tile;
+}
+
+// Estimates the bytes touched by one tile of `op` with loop sizes `loopTile`,
+// including the tiles of the producers fused into it.
+int64_t getTileFootprint(linalg::LinalgOp op, ArrayRef<int64_t> loopTile) {
+  int64_t bytes = 0;
+  for (OpOperand &operand : op->getOpOperands()) {
+    auto type = dyn_cast<RankedTensorType>(operand.get().getType());
+    if (!type)
+      continue;
+    SmallVector<int64_t> operandTile = getOperandTile(
+        op.getMatchingIndexingMap(&operand), loopTile, type.getShape());
+    int64_t elements = 1;
+    for (int64_t size : operandTile)
+      elements *= size;
+    bytes += elements * getElementBytes(type);
+
+    linalg::LinalgOp producer = getFusableProducer(operand);
+    if (!producer)
+      continue;
+    // The producer computes the slice of its result read by the tile.
+    auto result = cast<OpResult>(operand.get());
+    AffineMap resultMap = producer.getIndexingMapMatchingResult(result);
+    SmallVector<int64_t> producerTile = producer.getStaticLoopRanges();
+    for (auto [i, expr] : llvm::enumerate(resultMap.getResults()))
+      if (auto dim = dyn_cast<AffineDimExpr>(expr))
+        producerTile[dim.getPosition()] = operandTile[i];
+    bytes += getTileFootprint(producer, producerTile);
+  }
+  return bytes;
+}
+
+class TileAndFusePass : public TileAndFuseBase<TileAndFusePass> {
+
+public:
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<affine::AffineDialect, arith::ArithDialect,
+                    linalg::LinalgDialect, scf::SCFDialect,
+                    tensor::TensorDialect>();
+  }
+
+  void runOnOperation() override {
+    auto moduleOp = getOperation();
+    // The ends of the chains: ops whose results feed no other linalg op.
+    SmallVector<linalg::LinalgOp> roots;
+    moduleOp.walk([&](linalg::LinalgOp op) {
+      if (!isTileable(op))
+        return;
+      for (Operation *user : op->getUsers())
+        if (isa<linalg::LinalgOp>(user))
+          return;
+      roots.push_back(op);
+    });
+    for (linalg::LinalgOp root : roots)
+      tileAndFuse(root);
+  }
+
+private:
+  // Halves the tile sizes of the parallel loops of `root`, outermost first,
+  // until a tile of the chain fits in the cache. Returns the full loop ranges
+  // if the whole chain fits already.
+  SmallVector<int64_t> getTileSizes(linalg::LinalgOp root) {
+    SmallVector<int64_t> tile = root.getStaticLoopRanges();
+    SmallVector<unsigned> parallelLoops;
+    root.getParallelDims(parallelLoops);
+    if (parallelLoops.empty())
+      return tile;
+
+    while (getTileFootprint(root, tile) > cacheSize) {
+      ArrayRef<unsigned> outerLoops = ArrayRef(parallelLoops).drop_back();
+      auto outer = llvm::find_if(outerLoops,
+                                 [&](unsigned loop) { return tile[loop] > 1; });
+      if (outer != outerLoops.end()) {
+        tile[*outer] = (tile[*outer] + 1) / 2;
+        continue;
+      }
+      int64_t &inner = tile[parallelLoops.back()];
+      if (inner <= kMinInnerTileSize)
+        break;
+      inner = std::max(kMinInnerTileSize, (inner + 1) / 2);
+    }
+    return tile;
+  }
+
+  void tileAndFuse(linalg::LinalgOp root) {
+    SmallVector<int64_t> ranges = root.getStaticLoopRanges();
+    SmallVector<int64_t> tile = getTileSizes(root);
+    if (tile == ranges)
+      return;
+
+    IRRewriter rewriter(root->getContext());
+    rewriter.setInsertionPoint(root);
+    SmallVector<OpFoldResult> tileSizes;
+    for (auto [range, size] : llvm::zip(ranges, tile))
+      // A tile size of 0 leaves the loop untiled.
+      tileSizes.push_back(rewriter.getIndexAttr(size == range ? 0 : size));
+
+    llvm::SetVector<Operation *> chain;
+    collectChain(root, chain);
+
+    scf::SCFTileAndFuseOptions options;
+    options.tilingOptions.setTileSizes(tileSizes);
+    options.setFusionControlFn(
+        [&](tensor::ExtractSliceOp, OpResult producer, bool)
+            -> std::optional<scf::SCFTileAndFuseOptions::ControlFnResult> {
+          if (!chain.contains(producer.getOwner()))
+            return std::nullopt;
+          return scf::SCFTileAndFuseOptions::ControlFnResult{};
+        });
+    FailureOr<scf::SCFTileAndFuseResult> tiled =
+        scf::tileConsumerAndFuseProducersUsingSCF(
+            rewriter, cast<TilingInterface>(root.getOperation()), options);
+    if (failed(tiled))
+      return;
+
+    for (OpResult result : root->getResults())
+      if (Value replacement = tiled->replacements.lookup(result))
+        rewriter.replaceAllUsesWith(result, replacement);
+    // The chain is now dead, consumers first.
+    for (Operation *op : chain)
+      if (op->use_empty())
+        rewriter.eraseOp(op);
+  }
+};
+} // namespace
+
+std::unique_ptr<OperationPass<ModuleOp>> triton::createTileAndFusePass() {
+  return std::make_unique<TileAndFusePass>();
+}
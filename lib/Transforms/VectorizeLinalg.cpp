@@ -0,0 +1,140 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+//===----------------------------------------------------------------------===//
+
+#include "triton-shared/Transforms/VectorizeLinalg.h"
+
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Linalg/IR/Linalg.h"
+#include "mlir/Dialect/Linalg/Transforms/Transforms.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/SCF/Transforms/TileUsingInterface.h"
+#include "mlir/Dialect/Tensor/IR/Tensor.h"
+#include "mlir/Dialect/Tensor/Transforms/Transforms.h"
+#include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/Dialect/Vector/Transforms/LoweringPatterns.h"
+#include "mlir/Dialect/Vector/Transforms/VectorRewritePatterns.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+
+#include "llvm/ADT/SmallVector.h"
+
+using namespace mlir;
+using namespace triton;
+
+#define GEN_PASS_CLASSES
+#include "triton-shared/Transforms/Passes.h.inc"
+
+namespace {
+
+// Elementwise, broadcast, transpose and reduction ops with static shapes.
+// Contractions are left to the matmul lowering.
+bool isVectorizable(linalg::LinalgOp op) {
+  if (!op.hasPureTensorSemantics() || op.getNumLoops() == 0 ||
+      op.hasDynamicShape())
+    return false;
+  if (linalg::isaContractionOpInterface(op) ||
+      linalg::isaConvolutionOpInterface(op))
+    return false;
+  if (!llvm::all_of(op.getIndexingMapsArray(), [](AffineMap map) {
+        return map.isProjectedPermutation();
+      }))
+    return false;
+  return succeeded(linalg::vectorizeOpPrecondition(op));
+}
+
+// Number of elements of the widest element type of `op` in `vectorBits`.
+int64_t getVectorLength(linalg::LinalgOp op, unsigned vectorBits) {
+  unsigned maxBitWidth = 8;
+  for (Value operand : op->getOperands()) {
+    Type elementType = getElementTypeOrSelf(operand.getType());
+    if (elementType.isIntOrFloat())
+      maxBitWidth = std::max(maxBitWidth, elementType.getIntOrFloatBitWidth());
+  }
+  return std::max<int64_t>(1, vectorBits / maxBitWidth);
+}
+
+class VectorizeLinalgPass : public VectorizeLinalgBase<VectorizeLinalgPass> {
+
+public:
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<affine::AffineDialect, arith::ArithDialect,
+                    scf::SCFDialect, tensor::TensorDialect,
+                    vector::VectorDialect>();
+  }
+
+  void runOnOperation() override {
+    auto moduleOp = getOperation();
+    SmallVector<linalg::LinalgOp> ops;
+    moduleOp.walk([&](linalg::LinalgOp op) {
+      if (isVectorizable(op))
+        ops.push_back(op);
+    });
+    for (linalg::LinalgOp op : ops)
+      vectorize(op);
+
+    // Transfers of the tiles read and write the whole tensors directly
+    // rather than slices of them, which bufferizes in place.
+    RewritePatternSet patterns(&getContext());
+    tensor::populateFoldTensorSubsetOpPatterns(patterns);
+    vector::populateVectorMaskLoweringPatternsForSideEffectingOps(patterns);
+    vector::populateCastAwayVectorLeadingOneDimPatterns(patterns);
+    vector::populateVectorMultiReductionLoweringPatterns(
+        patterns, vector::VectorMultiReductionLowering::InnerReduction);
+    vector::populateVectorTransferPermutationMapLoweringPatterns(patterns);
+    scf::ForOp::getCanonicalizationPatterns(patterns, &getContext());
+    if (failed(applyPatternsGreedily(moduleOp, std::move(patterns))))
+      signalPassFailure();
+  }
+
+private:
+  // Tiles `op` to one vector along its innermost loop and to unit size along
+  // the other loops, then vectorizes the tile. Loops that already fit in a
+  // tile are not tiled.
+  void vectorize(linalg::LinalgOp op) {
+    IRRewriter rewriter(op->getContext());
+    rewriter.setInsertionPoint(op);
+
+    SmallVector<int64_t> ranges = op.getStaticLoopRanges();
+    int64_t vectorLength = getVectorLength(op, vectorBits);
+    SmallVector<int64_t> vectorSizes(ranges.size(), 1);
+    vectorSizes.back() = std::min(vectorLength, ranges.back());
+
+    SmallVector<OpFoldResult> tileSizes;
+    bool needsTiling = false;
+    for (auto [range, size] : llvm::zip(ranges, vectorSizes)) {
+      // A tile size of 0 leaves the loop untiled.
+      tileSizes.push_back(rewriter.getIndexAttr(range == size ? 0 : size));
+      needsTiling |= range != size;
+    }
+
+    if (!needsTiling) {
+      (void)linalg::vectorize(rewriter, op, vectorSizes);
+      return;
+    }
+
+    scf::SCFTilingOptions options;
+    options.setTileSizes(tileSizes);
+    FailureOr<scf::SCFTilingResult> tiled = scf::tileUsingSCF(
+        rewriter, cast<TilingInterface>(op.getOperation()), options);
+    if (failed(tiled))
+      return;
+    rewriter.replaceOp(op, tiled->replacements);
+
+    // The innermost tile of a loop that is not a multiple of the vector
+    // length has a dynamic size, so it is vectorized with masks.
+    for (Operation *tiledOp : tiled->tiledOps) {
+      rewriter.setInsertionPoint(tiledOp);
+      (void)linalg::vectorize(rewriter, tiledOp, vectorSizes);
+    }
+  }
+};
+} // namespace
+
+std::unique_ptr<OperationPass<ModuleOp>> triton::createVectorizeLinalgPass() {
+  return std::make_unique<VectorizeLinalgPass>();
+}
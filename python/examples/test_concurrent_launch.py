@@ -0,0 +1,34 @@
+from concurrent.futures import ThreadPoolExecutor
+
+import torch
+
+import triton
+import triton.language as tl
+
+
+@triton.jit
+def scale_kernel(x_ptr, output_ptr, scale, n_elements, BLOCK_SIZE: tl.constexpr):
+    pid = tl.program_id(axis=0)
+    offsets = pid * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+    mask = offsets < n_elements
+    x = tl.load(x_ptr + offsets, mask=mask)
+    tl.store(output_ptr + offsets, x * scale, mask=mask)
+
+
+def test_concurrent_launch(device):
+    # The launcher releases the GIL while the kernel runs, so independent
+    # launches from several Python threads overlap and must not interfere.
+    n_elements = 100000
+    num_requests = 16
+
+    def run(request):
+        x = torch.rand(n_elements, device=device)
+        output = torch.empty_like(x)
+        grid = lambda meta: (triton.cdiv(n_elements, meta['BLOCK_SIZE']), )
+        for _ in range(4):
+            scale_kernel[grid](x, output, float(request), n_elements, BLOCK_SIZE=1024)
+        return x * request, output
+
+    with ThreadPoolExecutor(max_workers=4) as pool:
+        for expected, output in pool.map(run, range(num_requests)):
+            torch.testing.assert_close(output, expected)
@@ -0,0 +1,40 @@
+import torch
+
+import triton
+import triton.language as tl
+from triton.runtime import driver
+
+
+@triton.jit
+def persistent_add_kernel(x_ptr, y_ptr, output_ptr, n_elements, BLOCK_SIZE: tl.constexpr):
+    start = tl.program_id(axis=0)
+    num_programs = tl.num_programs(axis=0)
+    num_blocks = tl.cdiv(n_elements, BLOCK_SIZE)
+    for block in range(start, num_blocks, num_programs):
+        offsets = block * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        mask = offsets < n_elements
+        x = tl.load(x_ptr + offsets, mask=mask)
+        y = tl.load(y_ptr + offsets, mask=mask)
+        tl.store(output_ptr + offsets, x + y, mask=mask)
+
+
+def test_device_properties(device):
+    props = driver.active.utils.get_device_properties(device)
+    assert props["multiprocessor_count"] >= 1
+    assert props["num_physical_cores"] >= 1
+    assert props["num_cpus"] >= props["num_physical_cores"]
+    assert props["threads_per_core"] >= 1
+    assert props["num_numa_nodes"] >= 1
+    assert props["simd_width"] in (128, 256, 512)
+    assert props["cache_line_size"] > 0
+
+
+def test_persistent_grid(device):
+    # Size the grid from the number of threads executing it.
+    num_programs = driver.active.utils.get_device_properties(device)["multiprocessor_count"]
+    n_elements = 10000
+    x = torch.rand(n_elements, device=device)
+    y = torch.rand(n_elements, device=device)
+    output = torch.empty_like(x)
+    persistent_add_kernel[(num_programs, )](x, y, output, n_elements, BLOCK_SIZE=64)
+    torch.testing.assert_close(output, x + y)
@@ -0,0 +1,39 @@
+import torch
+
+import triton
+import triton.language as tl
+
+
+@triton.jit
+def fma_exp(out_ptr, a_ptr, b_ptr, c_ptr, scale_ptr, BLOCK_M: tl.constexpr, BLOCK_N: tl.constexpr):
+    rows = tl.arange(0, BLOCK_M)
+    cols = tl.arange(0, BLOCK_N)
+    offsets = rows[:, None] * BLOCK_N + cols[None, :]
+    a = tl.load(a_ptr + offsets)
+    b = tl.load(b_ptr + offsets).to(tl.float32)
+    c = tl.load(c_ptr + offsets)
+    scale = tl.load(scale_ptr + cols)
+    tl.store(out_ptr + offsets, tl.exp(a * b + c) * scale[None, :] + 0.5)
+
+
+def test_fused_chain(device):
+    a = torch.randn(32, 64, device=device)
+    b = torch.randn(32, 64, device=device).to(torch.float16)
+    c = torch.randn(32, 64, device=device)
+    scale = torch.randn(64, device=device)
+    out = torch.empty_like(a)
+    fma_exp[(1, )](out, a, b, c, scale, BLOCK_M=32, BLOCK_N=64, fuse_elementwise=True)
+    torch.testing.assert_close(out, torch.exp(a * b.to(torch.float32) + c) * scale[None, :] + 0.5)
+
+
+def test_all_stages(device):
+    # Fusion, tiling and vectorization together, with a cache small enough to
+    # tile the block.
+    a = torch.randn(32, 64, device=device)
+    b = torch.randn(32, 64, device=device).to(torch.float16)
+    c = torch.randn(32, 64, device=device)
+    scale = torch.randn(64, device=device)
+    out = torch.empty_like(a)
+    fma_exp[(1, )](out, a, b, c, scale, BLOCK_M=32, BLOCK_N=64, fuse_elementwise=True, tile_and_fuse=True,
+                   cache_size=4096, vectorize_linalg=True)
+    torch.testing.assert_close(out, torch.exp(a * b.to(torch.float32) + c) * scale[None, :] + 0.5)
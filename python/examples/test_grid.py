@@ -0,0 +1,32 @@
+import pytest
+import torch
+
+import triton
+import triton.language as tl
+
+
+@triton.jit
+def program_ids(out_ptr):
+    pid_x = tl.program_id(axis=0)
+    pid_y = tl.program_id(axis=1)
+    pid_z = tl.program_id(axis=2)
+    num_y = tl.num_programs(axis=1)
+    num_z = tl.num_programs(axis=2)
+    linear = (pid_x * num_y + pid_y) * num_z + pid_z
+    tl.store(out_ptr + linear * 3 + 0, pid_x)
+    tl.store(out_ptr + linear * 3 + 1, pid_y)
+    tl.store(out_ptr + linear * 3 + 2, pid_z)
+
+
+@pytest.mark.parametrize("grid_as_loop", [False, True])
+def test_3d_grid(device, grid_as_loop):
+    # Every program must run exactly once with its own (x, y, z) ids no matter
+    # how the launcher distributes them over threads, and whether the kernel
+    # loops over its share of the grid itself.
+    grid = (37, 5, 3)
+    out = torch.full((grid[0] * grid[1] * grid[2], 3), -1, device=device, dtype=torch.int32)
+    program_ids[grid](out, grid_as_loop=grid_as_loop)
+
+    xs, ys, zs = torch.meshgrid(torch.arange(grid[0]), torch.arange(grid[1]), torch.arange(grid[2]), indexing="ij")
+    expected = torch.stack([xs.flatten(), ys.flatten(), zs.flatten()], dim=1).to(torch.int32)
+    torch.testing.assert_close(out, expected)
@@ -0,0 +1,61 @@
+import pytest
+import torch
+
+import triton
+import triton.language as tl
+
+
+@triton.jit
+def matmul_kernel(a_ptr, b_ptr, c_ptr, M, N, K, stride_am, stride_ak, stride_bk, stride_bn, stride_cm, stride_cn,
+                  BLOCK_M: tl.constexpr, BLOCK_N: tl.constexpr, BLOCK_K: tl.constexpr):
+    pid_m = tl.program_id(0)
+    pid_n = tl.program_id(1)
+    offs_m = pid_m * BLOCK_M + tl.arange(0, BLOCK_M)
+    offs_n = pid_n * BLOCK_N + tl.arange(0, BLOCK_N)
+    offs_k = tl.arange(0, BLOCK_K)
+    a_ptrs = a_ptr + offs_m[:, None] * stride_am + offs_k[None, :] * stride_ak
+    b_ptrs = b_ptr + offs_k[:, None] * stride_bk + offs_n[None, :] * stride_bn
+    acc = tl.zeros((BLOCK_M, BLOCK_N), dtype=tl.float32)
+    for k in range(0, tl.cdiv(K, BLOCK_K)):
+        a = tl.load(a_ptrs, mask=offs_k[None, :] < K - k * BLOCK_K, other=0.0)
+        b = tl.load(b_ptrs, mask=offs_k[:, None] < K - k * BLOCK_K, other=0.0)
+        acc += tl.dot(a, b)
+        a_ptrs += BLOCK_K * stride_ak
+        b_ptrs += BLOCK_K * stride_bk
+    c_ptrs = c_ptr + offs_m[:, None] * stride_cm + offs_n[None, :] * stride_cn
+    tl.store(c_ptrs, acc, mask=(offs_m[:, None] < M) & (offs_n[None, :] < N))
+
+
+def matmul(a, b, block_m, block_n, block_k):
+    M, K = a.shape
+    N = b.shape[1]
+    c = torch.empty((M, N), device=a.device, dtype=torch.float32)
+    grid = (triton.cdiv(M, block_m), triton.cdiv(N, block_n))
+    matmul_kernel[grid](a, b, c, M, N, K, a.stride(0), a.stride(1), b.stride(0), b.stride(1), c.stride(0), c.stride(1),
+                        BLOCK_M=block_m, BLOCK_N=block_n, BLOCK_K=block_k, matmul_library=True)
+    return c
+
+
+@pytest.mark.parametrize("dtype", [torch.float32, torch.float16, torch.bfloat16])
+def test_matmul(device, dtype):
+    # K is not a multiple of the block, so the last tt.dot reads masked loads.
+    a = torch.randn((64, 100), device=device).to(dtype)
+    b = torch.randn((100, 96), device=device).to(dtype)
+    c = matmul(a, b, 32, 32, 32)
+    torch.testing.assert_close(c, a.float() @ b.float(), rtol=1e-4, atol=1e-3)
+
+
+def test_transposed_operand(device):
+    a = torch.randn((48, 40), device=device)
+    b = torch.randn((24, 40), device=device).t()
+    c = matmul(a, b, 16, 8, 8)
+    torch.testing.assert_close(c, a @ b, rtol=1e-4, atol=1e-3)
+
+
+def test_single_program(device):
+    # One program multiplies the whole block, large enough to be split over
+    # the worker threads of the runtime.
+    a = torch.randn((512, 512), device=device)
+    b = torch.randn((512, 512), device=device)
+    c = matmul(a, b, 512, 512, 512)
+    torch.testing.assert_close(c, a @ b, rtol=1e-4, atol=1e-3)
@@ -0,0 +1,70 @@
+import pytest
+import torch
+
+import triton
+import triton.language as tl
+from triton._C.libtriton import triton_shared
+
+
+@triton.jit
+def masked_add_one(out_ptr, in_ptr, n, BLOCK_SIZE: tl.constexpr):
+    # The masked load goes through a buffer of BLOCK_SIZE elements allocated by
+    # the kernel, which never frees it.
+    offsets = tl.arange(0, BLOCK_SIZE)
+    x = tl.load(in_ptr + offsets, mask=offsets < n, other=0.0)
+    tl.store(out_ptr + offsets, x + 1.0, mask=offsets < n)
+
+
+def system_blocks():
+    return triton_shared.runtime.get_memory_stats()["system_blocks"]
+
+
+# Buffers of 4 KiB come from the arena, of 512 KiB and 4 MiB from size classes.
+# A single program runs on the launching thread, so every launch reuses the
+# same per-thread arena and size class cache.
+@pytest.mark.parametrize("block_size", [1 << 10, 1 << 17, 1 << 20])
+def test_buffers_released_with_program(device, block_size):
+    n = block_size - 3
+    x = torch.randn(n, device=device)
+    out = torch.empty_like(x)
+    masked_add_one[(1, )](out, x, n, BLOCK_SIZE=block_size)
+    torch.testing.assert_close(out, x + 1.0)
+
+    blocks = system_blocks()
+    for _ in range(10):
+        masked_add_one[(1, )](out, x, n, BLOCK_SIZE=block_size)
+    torch.testing.assert_close(out, x + 1.0)
+    assert system_blocks() == blocks
+
+
+@triton.jit
+def masked_sum(out_ptr, in_ptr, n, BLOCK_SIZE: tl.constexpr):
+    # Every program allocates its own buffer for the masked load.
+    pid = tl.program_id(axis=0)
+    offsets = tl.arange(0, BLOCK_SIZE)
+    x = tl.load(in_ptr + offsets, mask=offsets < n, other=0.0)
+    tl.store(out_ptr + pid, tl.sum(x, axis=0))
+
+
+# A grid much larger than the thread count, with buffers of 512 KiB from size
+# classes. Each thread runs one program at a time, so it holds a few blocks
+# however many programs it runs, also when a grid-as-loop kernel runs a range
+# of programs per call.
+@pytest.mark.parametrize("grid_as_loop", [False, True])
+def test_buffers_bounded_over_grid(device, grid_as_loop):
+    num_programs = 1024
+    block_size = 1 << 17
+    n = block_size - 3
+    x = torch.ones(n, device=device)
+    out = torch.empty(num_programs, device=device)
+    masked_sum[(num_programs, )](out, x, n, BLOCK_SIZE=block_size, grid_as_loop=grid_as_loop)
+    torch.testing.assert_close(out, torch.full_like(out, n))
+
+    blocks = system_blocks()
+    triton_shared.runtime.reset_peak_memory_stats()
+    for _ in range(3):
+        masked_sum[(num_programs, )](out, x, n, BLOCK_SIZE=block_size, grid_as_loop=grid_as_loop)
+    torch.testing.assert_close(out, torch.full_like(out, n))
+    num_threads = triton_shared.runtime.get_cpu_properties()["num_threads"]
+    peak = triton_shared.runtime.get_memory_stats()["peak_system_blocks"]
+    assert peak <= blocks + 4 * num_threads
@@ -0,0 +1,51 @@
+import pytest
+import torch
+
+import triton
+import triton.language as tl
+
+
+# Loads through a runtime stride become copies with a dynamic innermost
+# stride, which the CPU runtime performs in memrefCopy (see CRunnerUtils.cpp).
+@triton.jit
+def strided_load_2d(out_ptr, in_ptr, stride_m, stride_n, BLOCK_M: tl.constexpr, BLOCK_N: tl.constexpr):
+    offs_m = tl.arange(0, BLOCK_M)
+    offs_n = tl.arange(0, BLOCK_N)
+    x = tl.load(in_ptr + offs_m[:, None] * stride_m + offs_n[None, :] * stride_n)
+    tl.store(out_ptr + offs_m[:, None] * BLOCK_N + offs_n[None, :], x)
+
+
+@triton.jit
+def strided_load_1d(out_ptr, in_ptr, stride, BLOCK_SIZE: tl.constexpr):
+    offsets = tl.arange(0, BLOCK_SIZE)
+    x = tl.load(in_ptr + offsets * stride)
+    tl.store(out_ptr + offsets, x)
+
+
+# (1024, 2048) copies 8 MiB, above the threshold of the parallel copy.
+@pytest.mark.parametrize("shape", [(4, 8), (64, 32), (1024, 2048)])
+def test_strided(device, shape):
+    m, n = shape
+    x = torch.randn(m, 3 * n, device=device)[:, ::3]
+    out = torch.empty(m, n, device=device)
+    strided_load_2d[(1, )](out, x, x.stride(0), x.stride(1), BLOCK_M=m, BLOCK_N=n)
+    torch.testing.assert_close(out, x)
+
+
+# A zero outer stride reads the same row over and over.
+@pytest.mark.parametrize("shape", [(4, 8), (1024, 2048)])
+def test_broadcast(device, shape):
+    m, n = shape
+    x = torch.randn(3 * n, device=device)[::3]
+    out = torch.empty(m, n, device=device)
+    strided_load_2d[(1, )](out, x, 0, x.stride(0), BLOCK_M=m, BLOCK_N=n)
+    torch.testing.assert_close(out, x.expand(m, n))
+
+
+# A single row of 8 MiB is cut into segments copied in parallel.
+def test_large_row(device):
+    n = 1 << 21
+    x = torch.randn(2 * n, device=device)[::2]
+    out = torch.empty(n, device=device)
+    strided_load_1d[(1, )](out, x, x.stride(0), BLOCK_SIZE=n)
+    torch.testing.assert_close(out, x)
@@ -0,0 +1,34 @@
+import torch
+
+import triton
+import triton.language as tl
+from triton.backends.triton_shared.precompile import precompile
+
+configs = [triton.Config({'BLOCK_SIZE': block_size}) for block_size in [16, 32, 64, 128, 256]]
+
+
+@triton.autotune(configs=configs, key=['n_elements'])
+@triton.jit
+def add_kernel(x_ptr, y_ptr, output_ptr, n_elements, BLOCK_SIZE: tl.constexpr):
+    pid = tl.program_id(axis=0)
+    offsets = pid * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+    mask = offsets < n_elements
+    x = tl.load(x_ptr + offsets, mask=mask)
+    y = tl.load(y_ptr + offsets, mask=mask)
+    tl.store(output_ptr + offsets, x + y, mask=mask)
+
+
+def test_precompile(device):
+    n_elements = 1000
+    x = torch.rand(n_elements, device=device)
+    y = torch.rand(n_elements, device=device)
+    output = torch.empty_like(x)
+
+    kernels = precompile(add_kernel, x, y, output, n_elements, max_workers=4)
+    assert len(kernels) == len(configs)
+    assert all(kernel is not None for kernel in kernels)
+
+    # Benchmarking the configs now only hits the cache.
+    grid = lambda meta: (triton.cdiv(n_elements, meta['BLOCK_SIZE']), )
+    add_kernel[grid](x, y, output, n_elements)
+    torch.testing.assert_close(output, x + y)
@@ -0,0 +1,53 @@
+import torch
+
+import triton
+import triton.language as tl
+from triton.backends.triton_shared.stream import Event, Stream, stream
+
+
+@triton.jit
+def axpy_kernel(x_ptr, y_ptr, output_ptr, a, n_elements, BLOCK_SIZE: tl.constexpr):
+    pid = tl.program_id(axis=0)
+    offsets = pid * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+    mask = offsets < n_elements
+    x = tl.load(x_ptr + offsets, mask=mask)
+    y = tl.load(y_ptr + offsets, mask=mask)
+    tl.store(output_ptr + offsets, a * x + y, mask=mask)
+
+
+def test_stream_ordering(device):
+    # Launches on one stream run in order: every step reads the output of the
+    # previous one.
+    n_elements = 4096
+    x = torch.rand(n_elements, device=device)
+    y = torch.zeros(n_elements, device=device)
+    grid = lambda meta: (triton.cdiv(n_elements, meta['BLOCK_SIZE']), )
+
+    s = Stream()
+    with stream(s):
+        for _ in range(8):
+            axpy_kernel[grid](x, y, y, 1.0, n_elements, BLOCK_SIZE=256)
+    s.synchronize()
+    assert s.query()
+    torch.testing.assert_close(y, 8 * x)
+
+
+def test_event_dependency(device):
+    # The consumer stream waits for the producer through an event.
+    n_elements = 4096
+    x = torch.rand(n_elements, device=device)
+    y = torch.zeros(n_elements, device=device)
+    z = torch.zeros(n_elements, device=device)
+    grid = lambda meta: (triton.cdiv(n_elements, meta['BLOCK_SIZE']), )
+
+    producer, consumer = Stream(), Stream()
+    produced = Event()
+    with stream(producer):
+        axpy_kernel[grid](x, y, y, 2.0, n_elements, BLOCK_SIZE=256)
+    producer.record_event(produced)
+    consumer.wait_event(produced)
+    with stream(consumer):
+        axpy_kernel[grid](y, x, z, 1.0, n_elements, BLOCK_SIZE=256)
+    consumer.synchronize()
+    assert produced.query()
+    torch.testing.assert_close(z, 3 * x)
@@ -0,0 +1,38 @@
+import pytest
+import torch
+
+import triton
+import triton.language as tl
+
+
+@triton.jit
+def fused_chain(out_ptr, a_ptr, b_ptr, c_ptr, BLOCK_M: tl.constexpr, BLOCK_N: tl.constexpr):
+    offsets = tl.arange(0, BLOCK_M)[:, None] * BLOCK_N + tl.arange(0, BLOCK_N)[None, :]
+    a = tl.load(a_ptr + offsets)
+    b = tl.load(b_ptr + offsets)
+    c = tl.load(c_ptr + offsets)
+    tl.store(out_ptr + offsets, tl.exp(a * b + c))
+
+
+@triton.jit
+def row_max(out_ptr, in_ptr, BLOCK_M: tl.constexpr, BLOCK_N: tl.constexpr):
+    offsets = tl.arange(0, BLOCK_M)[:, None] * BLOCK_N + tl.arange(0, BLOCK_N)[None, :]
+    x = tl.load(in_ptr + offsets)
+    tl.store(out_ptr + tl.arange(0, BLOCK_M), tl.max(x * 2.0, axis=1))
+
+
+# A tiny cache size forces the blocks to be processed in many tiles.
+@pytest.mark.parametrize("cache_size", [0, 4096])
+def test_elementwise_chain(device, cache_size):
+    a, b, c = (torch.randn(128, 64, device=device) for _ in range(3))
+    out = torch.empty_like(a)
+    fused_chain[(1, )](out, a, b, c, BLOCK_M=128, BLOCK_N=64, tile_and_fuse=True, cache_size=cache_size)
+    torch.testing.assert_close(out, torch.exp(a * b + c))
+
+
+@pytest.mark.parametrize("cache_size", [0, 4096])
+def test_reduction(device, cache_size):
+    x = torch.randn(128, 64, device=device)
+    out = torch.empty(128, device=device)
+    row_max[(1, )](out, x, BLOCK_M=128, BLOCK_N=64, tile_and_fuse=True, cache_size=cache_size)
+    torch.testing.assert_close(out, (x * 2.0).max(dim=1).values)
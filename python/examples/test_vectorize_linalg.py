@@ -0,0 +1,47 @@
+import pytest
+import torch
+
+import triton
+import triton.language as tl
+
+
+@triton.jit
+def scale_rows(out_ptr, in_ptr, scale_ptr, n_cols, BLOCK_M: tl.constexpr, BLOCK_N: tl.constexpr):
+    rows = tl.program_id(0) * BLOCK_M + tl.arange(0, BLOCK_M)
+    cols = tl.arange(0, BLOCK_N)
+    mask = cols[None, :] < n_cols
+    x = tl.load(in_ptr + rows[:, None] * n_cols + cols[None, :], mask=mask, other=0.0)
+    scale = tl.load(scale_ptr + rows)
+    y = x * scale[:, None] + 1.0
+    tl.store(out_ptr + rows[:, None] * n_cols + cols[None, :], y, mask=mask)
+
+
+@triton.jit
+def row_sums(out_ptr, in_ptr, n_cols, BLOCK_M: tl.constexpr, BLOCK_N: tl.constexpr):
+    rows = tl.program_id(0) * BLOCK_M + tl.arange(0, BLOCK_M)
+    cols = tl.arange(0, BLOCK_N)
+    x = tl.load(in_ptr + rows[:, None] * n_cols + cols[None, :], mask=cols[None, :] < n_cols, other=0.0)
+    tl.store(out_ptr + rows, tl.sum(x, axis=1))
+
+
+# Block widths that are and are not multiples of every vector length, so that
+# both full and masked tail vectors are exercised.
+@pytest.mark.parametrize("block_n", [16, 20])
+@pytest.mark.parametrize("vector_bits", [0, 128])
+def test_elementwise(device, block_n, vector_bits):
+    n_rows, n_cols = 32, block_n - 3
+    x = torch.randn(n_rows, n_cols, device=device)
+    scale = torch.randn(n_rows, device=device)
+    out = torch.empty_like(x)
+    scale_rows[(n_rows // 8, )](out, x, scale, n_cols, BLOCK_M=8, BLOCK_N=block_n, vectorize_linalg=True,
+                                vector_bits=vector_bits)
+    torch.testing.assert_close(out, x * scale[:, None] + 1.0)
+
+
+@pytest.mark.parametrize("block_n", [16, 20])
+def test_reduction(device, block_n):
+    n_rows, n_cols = 32, block_n - 3
+    x = torch.randn(n_rows, n_cols, device=device)
+    out = torch.empty(n_rows, device=device)
+    row_sums[(n_rows // 8, )](out, x, n_cols, BLOCK_M=8, BLOCK_N=block_n, vectorize_linalg=True)
+    torch.testing.assert_close(out, x.sum(dim=1))
@@ -0,0 +1,90 @@
+// RUN: triton-shared-opt --triton-shared-cpu-pipeline %s | FileCheck %s --check-prefixes=CHECK,INPLACE
+// RUN: triton-shared-opt --triton-shared-cpu-pipeline="target-cpu=skylake target-features=+avx2,+fma" %s | FileCheck %s --check-prefix=TARGET
+// RUN: triton-shared-opt --triton-shared-cpu-pipeline="vectorize=true vector-size=8 tile-sizes=32" %s | FileCheck %s --check-prefix=VECTOR
+// RUN: triton-shared-opt --triton-shared-cpu-pipeline="bufferization-mode=copy-before-write" %s | FileCheck %s
+// RUN: triton-shared-opt --triton-shared-cpu-pipeline="matmul-library=true" %s | FileCheck %s --check-prefix=MATMUL
+
+module {
+  func.func @fill(%arg0: memref<*xf32>) {
+    %cst = arith.constant 1.000000e+00 : f32
+    %0 = memref.reinterpret_cast %arg0 to offset: [0], sizes: [128], strides: [1] : memref<*xf32> to memref<128xf32, strided<[1]>>
+    %1 = tensor.empty() : tensor<128xf32>
+    %2 = linalg.fill ins(%cst : f32) outs(%1 : tensor<128xf32>) -> tensor<128xf32>
+    bufferization.materialize_in_destination %2 in writable %0 : (tensor<128xf32>, memref<128xf32, strided<[1]>>) -> ()
+    return
+  }
+  func.func @scratch(%arg0: index) {
+    %0 = memref.alloc(%arg0) : memref<?xf32>
+    memref.dealloc %0 : memref<?xf32>
+    return
+  }
+  func.func @masked_copy(%arg0: memref<128x256xf32, strided<[?, 1], offset: ?>>, %arg1: memref<128x256xf32>, %arg2: index) {
+    %0 = memref.subview %arg0[0, 0] [128, %arg2] [1, 1] : memref<128x256xf32, strided<[?, 1], offset: ?>> to memref<128x?xf32, strided<[?, 1], offset: ?>>
+    %1 = memref.subview %arg1[0, 0] [128, %arg2] [1, 1] : memref<128x256xf32> to memref<128x?xf32, strided<[256, 1]>>
+    memref.copy %0, %1 : memref<128x?xf32, strided<[?, 1], offset: ?>> to memref<128x?xf32, strided<[256, 1]>>
+    return
+  }
+  func.func @dot(%arg0: memref<64x32xf32>, %arg1: memref<32x64xf32>, %arg2: memref<64x64xf32>) {
+    %cst = arith.constant 0.000000e+00 : f32
+    %0 = bufferization.to_tensor %arg0 restrict : memref<64x32xf32> to tensor<64x32xf32>
+    %1 = bufferization.to_tensor %arg1 restrict : memref<32x64xf32> to tensor<32x64xf32>
+    %2 = tensor.empty() : tensor<64x64xf32>
+    %3 = linalg.fill ins(%cst : f32) outs(%2 : tensor<64x64xf32>) -> tensor<64x64xf32>
+    %4 = linalg.matmul ins(%0, %1 : tensor<64x32xf32>, tensor<32x64xf32>) outs(%3 : tensor<64x64xf32>) -> tensor<64x64xf32>
+    bufferization.materialize_in_destination %4 in writable %arg2 : (tensor<64x64xf32>, memref<64x64xf32>) -> ()
+    return
+  }
+  func.func @dot_loop(%arg0: memref<64x32xf32>, %arg1: memref<32x64xf32>, %arg2: memref<64x64xf32>, %arg3: index) {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %0 = bufferization.to_tensor %arg0 restrict : memref<64x32xf32> to tensor<64x32xf32>
+    %1 = bufferization.to_tensor %arg1 restrict : memref<32x64xf32> to tensor<32x64xf32>
+    %2 = bufferization.to_tensor %arg2 restrict writable : memref<64x64xf32> to tensor<64x64xf32>
+    %3 = scf.for %iv = %c0 to %arg3 step %c1 iter_args(%acc = %2) -> (tensor<64x64xf32>) {
+      %4 = linalg.matmul ins(%0, %1 : tensor<64x32xf32>, tensor<32x64xf32>) outs(%acc : tensor<64x64xf32>) -> tensor<64x64xf32>
+      scf.yield %4 : tensor<64x64xf32>
+    }
+    bufferization.materialize_in_destination %3 in writable %arg2 : (tensor<64x64xf32>, memref<64x64xf32>) -> ()
+    return
+  }
+}
+
+// CHECK-LABEL: llvm.func @fill(
+// CHECK-NOT:     linalg.
+// CHECK-NOT:     memref.
+// CHECK:         llvm.store {{.*}} : f32, !llvm.ptr
+// CHECK:         llvm.return
+
+// Kernels allocate through the CPU runtime.
+// CHECK-LABEL: llvm.func @scratch(
+// CHECK:         llvm.call @_mlir_memref_to_llvm_alloc(
+// CHECK:         llvm.call @_mlir_memref_to_llvm_free(
+
+// Strided copies are expanded inline instead of calling the runtime.
+// CHECK-LABEL: llvm.func @masked_copy(
+// CHECK-NOT:     llvm.call @memrefCopy
+// CHECK:         llvm.load {{.*}} : !llvm.ptr -> f32
+// CHECK:         llvm.store {{.*}} : f32, !llvm.ptr
+// CHECK:         llvm.return
+
+// A matmul accumulating into the tensor carried by its loop, as tt.dot is
+// lowered, updates the buffer of the accumulator in place.
+// INPLACE-LABEL: llvm.func @dot_loop(
+// INPLACE-NOT:     llvm.call @_mlir_memref_to_llvm_alloc
+// INPLACE:         llvm.return
+
+// TARGET-LABEL: llvm.func @fill(
+// TARGET-SAME:    target_cpu = "skylake"
+// TARGET-SAME:    target_features = #llvm.target_features<["+avx2", "+fma"]>
+
+// VECTOR-LABEL: llvm.func @fill(
+// VECTOR:         llvm.store {{.*}} : vector<8xf32>, !llvm.ptr
+// VECTOR:         llvm.return
+
+
+// The packed matrix multiplication of the runtime computes linalg.matmul ops.
+// MATMUL-LABEL: llvm.func @triton_shared_matmul_f32(
+// MATMUL:         llvm.call @_mlir_ciface_triton_shared_matmul_f32(
+// MATMUL-LABEL: llvm.func @dot(
+// MATMUL:         llvm.call @triton_shared_matmul_f32(
+// MATMUL:         llvm.return
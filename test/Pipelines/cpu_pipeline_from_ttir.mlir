@@ -0,0 +1,27 @@
+// RUN: triton-shared-opt --triton-shared-cpu-pipeline="from-ttir=true" %s | FileCheck %s
+// RUN: triton-shared-opt --triton-shared-cpu-pipeline="from-ttir=true grid-as-loop=true" %s | FileCheck %s --check-prefix=GRID
+
+module {
+  tt.func @add_one(%arg0: !tt.ptr<f32>) {
+    %cst = arith.constant dense<1.000000e+00> : tensor<64xf32>
+    %0 = tt.make_range {end = 64 : i32, start = 0 : i32} : tensor<64xi32>
+    %1 = tt.splat %arg0 : !tt.ptr<f32> -> tensor<64x!tt.ptr<f32>>
+    %2 = tt.addptr %1, %0 : tensor<64x!tt.ptr<f32>>, tensor<64xi32>
+    %3 = tt.load %2 : tensor<64x!tt.ptr<f32>>
+    %4 = arith.addf %3, %cst : tensor<64xf32>
+    tt.store %2, %4 : tensor<64x!tt.ptr<f32>>
+    tt.return
+  }
+}
+
+// CHECK-LABEL: llvm.func @add_one(
+// CHECK-NOT:     tt.
+// CHECK:         llvm.fadd
+// CHECK:         llvm.return
+
+// The program body is inlined into the loop over the program range.
+// GRID-LABEL: llvm.func @add_one(
+// GRID-SAME:      i32, %{{.*}}: i32, %{{.*}}: i32, %{{.*}}: i64, %{{.*}}: i64)
+// GRID-NOT:       llvm.call
+// GRID:           llvm.fadd
+// GRID-NOT:   llvm.func internal @add_one_program(
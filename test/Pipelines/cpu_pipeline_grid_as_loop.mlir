@@ -0,0 +1,23 @@
+// RUN: triton-shared-opt --triton-shared-cpu-pipeline="grid-as-loop=true" --mlir-print-ir-after=loop-invariant-code-motion %s 2>&1 | FileCheck %s
+
+// The descriptor of the kernel argument is unpacked once per program range,
+// outside of the loop over the programs.
+
+module {
+  func.func @fill(%arg0: memref<*xf32>, %arg1: i32, %arg2: i32, %arg3: i32, %arg4: i32, %arg5: i32, %arg6: i32) {
+    %cst = arith.constant 1.000000e+00 : f32
+    %0 = memref.reinterpret_cast %arg0 to offset: [0], sizes: [128], strides: [1] : memref<*xf32> to memref<128xf32, strided<[1]>>
+    %1 = tensor.empty() : tensor<128xf32>
+    %2 = linalg.fill ins(%cst : f32) outs(%1 : tensor<128xf32>) -> tensor<128xf32>
+    bufferization.materialize_in_destination %2 in writable %0 : (tensor<128xf32>, memref<128xf32, strided<[1]>>) -> ()
+    return
+  }
+}
+
+// CHECK-LABEL: func.func @fill(
+// CHECK:         memref.reinterpret_cast
+// CHECK:         scf.parallel
+// CHECK-NOT:       memref.reinterpret_cast
+// CHECK-NOT:       func.call
+// CHECK:         return
+// CHECK-NOT:   func.func private @fill_program(
@@ -0,0 +1,56 @@
+// RUN: triton-shared-opt --triton-shared-expand-memref-copy %s | FileCheck %s
+
+module {
+  func.func @masked_load(%arg0: memref<128x256xbf16, strided<[?, 1], offset: ?>>, %arg1: index, %arg2: index) {
+    %alloc = memref.alloc() : memref<128x256xbf16>
+    %subview = memref.subview %arg0[0, 0] [%arg1, %arg2] [1, 1] : memref<128x256xbf16, strided<[?, 1], offset: ?>> to memref<?x?xbf16, strided<[?, 1], offset: ?>>
+    %subview_0 = memref.subview %alloc[0, 0] [%arg1, %arg2] [1, 1] : memref<128x256xbf16> to memref<?x?xbf16, strided<[256, 1]>>
+    memref.copy %subview, %subview_0 : memref<?x?xbf16, strided<[?, 1], offset: ?>> to memref<?x?xbf16, strided<[256, 1]>>
+    return
+  }
+  func.func @static_shape(%arg0: memref<4x8xf32, strided<[?, 1], offset: ?>>, %arg1: memref<4x8xf32>) {
+    memref.copy %arg0, %arg1 : memref<4x8xf32, strided<[?, 1], offset: ?>> to memref<4x8xf32>
+    return
+  }
+  func.func @contiguous(%arg0: memref<128xf32>, %arg1: memref<128xf32>) {
+    memref.copy %arg0, %arg1 : memref<128xf32> to memref<128xf32>
+    return
+  }
+  func.func @dynamic_inner_stride(%arg0: memref<?xf32, strided<[?], offset: ?>>, %arg1: memref<?xf32>) {
+    memref.copy %arg0, %arg1 : memref<?xf32, strided<[?], offset: ?>> to memref<?xf32>
+    return
+  }
+  func.func @unranked(%arg0: memref<*xf32>, %arg1: memref<*xf32>) {
+    memref.copy %arg0, %arg1 : memref<*xf32> to memref<*xf32>
+    return
+  }
+}
+
+// CHECK-LABEL: func.func @masked_load(
+// CHECK-DAG:       %[[C0:.*]] = arith.constant 0 : index
+// CHECK-DAG:       %[[C1:.*]] = arith.constant 1 : index
+// CHECK-DAG:       %[[SRC:.*]] = memref.subview %{{.*}}[0, 0]
+// CHECK-DAG:       %[[DST:.*]] = memref.subview %{{.*}}[0, 0]
+// CHECK-DAG:       %[[D0:.*]] = memref.dim %[[SRC]], %[[C0]]
+// CHECK-DAG:       %[[D1:.*]] = memref.dim %[[SRC]], %[[C1]]
+// CHECK:           scf.for %[[I:.*]] = %[[C0]] to %[[D0]] step %[[C1]] {
+// CHECK:             scf.for %[[J:.*]] = %[[C0]] to %[[D1]] step %[[C1]] {
+// CHECK:               %[[V:.*]] = memref.load %[[SRC]][%[[I]], %[[J]]]
+// CHECK:               memref.store %[[V]], %[[DST]][%[[I]], %[[J]]]
+// CHECK-NOT:       memref.copy
+
+// CHECK-LABEL: func.func @static_shape(
+// CHECK-DAG:       %[[C4:.*]] = arith.constant 4 : index
+// CHECK-DAG:       %[[C8:.*]] = arith.constant 8 : index
+// CHECK:           scf.for %{{.*}} = %{{.*}} to %[[C4]]
+// CHECK:             scf.for %{{.*}} = %{{.*}} to %[[C8]]
+// CHECK-NOT:       memref.copy
+
+// Contiguous copies are left to llvm.memcpy and copies with a dynamic
+// innermost stride to the runtime.
+// CHECK-LABEL: func.func @contiguous(
+// CHECK:           memref.copy
+// CHECK-LABEL: func.func @dynamic_inner_stride(
+// CHECK:           memref.copy
+// CHECK-LABEL: func.func @unranked(
+// CHECK:           memref.copy
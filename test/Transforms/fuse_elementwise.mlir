@@ -0,0 +1,96 @@
+// RUN: triton-shared-opt --triton-shared-fuse-elementwise %s | FileCheck %s
+// RUN: triton-shared-opt --triton-shared-fuse-elementwise="max-ops=2" %s | FileCheck %s --check-prefix=LIMIT
+
+#map = affine_map<(d0, d1) -> (d0, d1)>
+#bcast = affine_map<(d0, d1) -> (0, d1)>
+module {
+  // exp(a * b + c), with c a splat.
+  func.func @chain(%a: tensor<128x64xf32>, %b: tensor<128x64xf32>, %s: f32) -> tensor<128x64xf32> {
+    %0 = tensor.empty() : tensor<128x64xf32>
+    %c = linalg.fill ins(%s : f32) outs(%0 : tensor<128x64xf32>) -> tensor<128x64xf32>
+    %1 = linalg.generic {indexing_maps = [#map, #map, #map], iterator_types = ["parallel", "parallel"]} ins(%a, %b : tensor<128x64xf32>, tensor<128x64xf32>) outs(%0 : tensor<128x64xf32>) {
+    ^bb0(%in: f32, %in_0: f32, %out: f32):
+      %4 = arith.mulf %in, %in_0 : f32
+      linalg.yield %4 : f32
+    } -> tensor<128x64xf32>
+    %2 = linalg.generic {indexing_maps = [#map, #map, #map], iterator_types = ["parallel", "parallel"]} ins(%1, %c : tensor<128x64xf32>, tensor<128x64xf32>) outs(%0 : tensor<128x64xf32>) {
+    ^bb0(%in: f32, %in_0: f32, %out: f32):
+      %4 = arith.addf %in, %in_0 : f32
+      linalg.yield %4 : f32
+    } -> tensor<128x64xf32>
+    %3 = linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel", "parallel"]} ins(%2 : tensor<128x64xf32>) outs(%0 : tensor<128x64xf32>) {
+    ^bb0(%in: f32, %out: f32):
+      %4 = math.exp %in : f32
+      linalg.yield %4 : f32
+    } -> tensor<128x64xf32>
+    return %3 : tensor<128x64xf32>
+  }
+  // A broadcast of a row followed by a cast and an addition.
+  func.func @broadcast_cast(%row: tensor<1x64xf16>, %x: tensor<128x64xf32>) -> tensor<128x64xf32> {
+    %0 = tensor.empty() : tensor<128x64xf16>
+    %1 = linalg.generic {indexing_maps = [#bcast, #map], iterator_types = ["parallel", "parallel"]} ins(%row : tensor<1x64xf16>) outs(%0 : tensor<128x64xf16>) {
+    ^bb0(%in: f16, %out: f16):
+      linalg.yield %in : f16
+    } -> tensor<128x64xf16>
+    %2 = tensor.empty() : tensor<128x64xf32>
+    %3 = linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel", "parallel"]} ins(%1 : tensor<128x64xf16>) outs(%2 : tensor<128x64xf32>) {
+    ^bb0(%in: f16, %out: f32):
+      %5 = arith.extf %in : f16 to f32
+      linalg.yield %5 : f32
+    } -> tensor<128x64xf32>
+    %4 = linalg.generic {indexing_maps = [#map, #map, #map], iterator_types = ["parallel", "parallel"]} ins(%3, %x : tensor<128x64xf32>, tensor<128x64xf32>) outs(%2 : tensor<128x64xf32>) {
+    ^bb0(%in: f32, %in_0: f32, %out: f32):
+      %5 = arith.addf %in, %in_0 : f32
+      linalg.yield %5 : f32
+    } -> tensor<128x64xf32>
+    return %4 : tensor<128x64xf32>
+  }
+  // The consumer broadcasts an expensive producer along d0: no fusion.
+  func.func @broadcast_consumer(%row: tensor<64xf32>, %x: tensor<128x64xf32>) -> tensor<128x64xf32> {
+    %0 = tensor.empty() : tensor<64xf32>
+    %1 = linalg.generic {indexing_maps = [affine_map<(d0) -> (d0)>, affine_map<(d0) -> (d0)>], iterator_types = ["parallel"]} ins(%row : tensor<64xf32>) outs(%0 : tensor<64xf32>) {
+    ^bb0(%in: f32, %out: f32):
+      %4 = math.exp %in : f32
+      %5 = math.log %4 : f32
+      linalg.yield %5 : f32
+    } -> tensor<64xf32>
+    %2 = tensor.empty() : tensor<128x64xf32>
+    %3 = linalg.generic {indexing_maps = [affine_map<(d0, d1) -> (d1)>, #map, #map], iterator_types = ["parallel", "parallel"]} ins(%1, %x : tensor<64xf32>, tensor<128x64xf32>) outs(%2 : tensor<128x64xf32>) {
+    ^bb0(%in: f32, %in_0: f32, %out: f32):
+      %4 = arith.addf %in, %in_0 : f32
+      linalg.yield %4 : f32
+    } -> tensor<128x64xf32>
+    return %3 : tensor<128x64xf32>
+  }
+}
+
+// CHECK-LABEL: func.func @chain(
+// CHECK:           linalg.generic
+// CHECK:             arith.mulf
+// CHECK:             arith.addf
+// CHECK:             math.exp
+// CHECK:             linalg.yield
+// CHECK-NOT:       linalg.generic
+// CHECK-NOT:       linalg.fill
+
+// CHECK-LABEL: func.func @broadcast_cast(
+// CHECK:           linalg.generic {indexing_maps = [#{{.*}}, #{{.*}}, #{{.*}}]
+// CHECK-SAME:        ins(%{{.*}}, %{{.*}} : tensor<1x64xf16>, tensor<128x64xf32>)
+// CHECK:             arith.extf
+// CHECK:             arith.addf
+// CHECK-NOT:       linalg.generic
+
+// CHECK-LABEL: func.func @broadcast_consumer(
+// CHECK:           linalg.generic
+// CHECK:             math.exp
+// CHECK:             math.log
+// CHECK:           linalg.generic
+// CHECK:             arith.addf
+
+// With at most two ops per body, the chain stops after the addition.
+// LIMIT-LABEL: func.func @chain(
+// LIMIT:           linalg.generic
+// LIMIT:             arith.mulf
+// LIMIT:             arith.addf
+// LIMIT:           linalg.generic
+// LIMIT:             math.exp
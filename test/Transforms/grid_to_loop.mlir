@@ -0,0 +1,36 @@
+// RUN: triton-shared-opt --triton-shared-grid-to-loop %s | FileCheck %s
+
+module {
+  func.func @kernel(%arg0: memref<*xf32>, %arg1: i32, %arg2: i32, %arg3: i32, %arg4: i32, %arg5: i32, %arg6: i32, %arg7: i32) {
+    return
+  }
+  func.func private @helper(%arg0: i32, %arg1: i32, %arg2: i32, %arg3: i32, %arg4: i32, %arg5: i32)
+}
+
+// CHECK-DAG:   func.func private @triton_shared_end_program()
+// CHECK-DAG:   func.func private @triton_shared_begin_program()
+
+// CHECK-LABEL: func.func @kernel(
+// CHECK-SAME:      %[[ARG0:.*]]: memref<*xf32>, %[[ARG1:.*]]: i32, %[[GX:.*]]: i32, %[[GY:.*]]: i32, %[[GZ:.*]]: i32, %[[BEGIN:.*]]: i64, %[[END:.*]]: i64) {
+// CHECK-DAG:       %[[Y_SIZE:.*]] = arith.index_cast %[[GY]] : i32 to index
+// CHECK-DAG:       %[[Z_SIZE:.*]] = arith.index_cast %[[GZ]] : i32 to index
+// CHECK-DAG:       %[[LB:.*]] = arith.index_cast %[[BEGIN]] : i64 to index
+// CHECK-DAG:       %[[UB:.*]] = arith.index_cast %[[END]] : i64 to index
+// CHECK-DAG:       %[[ONE:.*]] = arith.constant 1 : index
+// CHECK:           scf.parallel (%[[IV:.*]]) = (%[[LB]]) to (%[[UB]]) step (%[[ONE]]) {
+// CHECK:             %[[Z:.*]] = arith.remui %[[IV]], %[[Z_SIZE]] : index
+// CHECK:             %[[XY:.*]] = arith.divui %[[IV]], %[[Z_SIZE]] : index
+// CHECK:             %[[Y:.*]] = arith.remui %[[XY]], %[[Y_SIZE]] : index
+// CHECK:             %[[X:.*]] = arith.divui %[[XY]], %[[Y_SIZE]] : index
+// CHECK:             %[[PID_X:.*]] = arith.index_cast %[[X]] : index to i32
+// CHECK:             %[[PID_Y:.*]] = arith.index_cast %[[Y]] : index to i32
+// CHECK:             %[[PID_Z:.*]] = arith.index_cast %[[Z]] : index to i32
+// CHECK:             func.call @triton_shared_begin_program() : () -> ()
+// CHECK:             func.call @kernel_program(%[[ARG0]], %[[ARG1]], %[[GX]], %[[GY]], %[[GZ]], %[[PID_X]], %[[PID_Y]], %[[PID_Z]])
+// CHECK:             func.call @triton_shared_end_program() : () -> ()
+// CHECK:           return
+
+// CHECK-LABEL: func.func private @kernel_program(
+// CHECK-SAME:      llvm.linkage = #llvm.linkage<internal>
+
+// CHECK-LABEL: func.func private @helper(
@@ -0,0 +1,60 @@
+// RUN: triton-shared-opt --triton-shared-matmul-to-library %s | FileCheck %s
+
+module {
+  func.func @f32(%arg0: memref<128x64xf32>, %arg1: memref<64x32xf32, strided<[?, 1], offset: ?>>, %arg2: memref<128x32xf32>) {
+    linalg.matmul ins(%arg0, %arg1 : memref<128x64xf32>, memref<64x32xf32, strided<[?, 1], offset: ?>>) outs(%arg2 : memref<128x32xf32>)
+    return
+  }
+  func.func @bf16(%arg0: memref<?x?xbf16, strided<[?, ?], offset: ?>>, %arg1: memref<?x?xbf16, strided<[?, ?], offset: ?>>, %arg2: memref<?x?xf32, strided<[?, ?], offset: ?>>) {
+    linalg.matmul ins(%arg0, %arg1 : memref<?x?xbf16, strided<[?, ?], offset: ?>>, memref<?x?xbf16, strided<[?, ?], offset: ?>>) outs(%arg2 : memref<?x?xf32, strided<[?, ?], offset: ?>>)
+    return
+  }
+  func.func @f16_twice(%arg0: memref<16x16xf16>, %arg1: memref<16x16xf16>, %arg2: memref<16x16xf32>) {
+    linalg.matmul ins(%arg0, %arg1 : memref<16x16xf16>, memref<16x16xf16>) outs(%arg2 : memref<16x16xf32>)
+    linalg.matmul ins(%arg1, %arg0 : memref<16x16xf16>, memref<16x16xf16>) outs(%arg2 : memref<16x16xf32>)
+    return
+  }
+  func.func @f16_result(%arg0: memref<16x16xf16>, %arg1: memref<16x16xf16>, %arg2: memref<16x16xf16>) {
+    linalg.matmul ins(%arg0, %arg1 : memref<16x16xf16>, memref<16x16xf16>) outs(%arg2 : memref<16x16xf16>)
+    return
+  }
+  func.func @i8(%arg0: memref<16x16xi8>, %arg1: memref<16x16xi8>, %arg2: memref<16x16xi32>) {
+    linalg.matmul ins(%arg0, %arg1 : memref<16x16xi8>, memref<16x16xi8>) outs(%arg2 : memref<16x16xi32>)
+    return
+  }
+  func.func @tensors(%arg0: tensor<16x16xf32>, %arg1: tensor<16x16xf32>, %arg2: tensor<16x16xf32>) -> tensor<16x16xf32> {
+    %0 = linalg.matmul ins(%arg0, %arg1 : tensor<16x16xf32>, tensor<16x16xf32>) outs(%arg2 : tensor<16x16xf32>) -> tensor<16x16xf32>
+    return %0 : tensor<16x16xf32>
+  }
+}
+
+// CHECK-DAG:   func.func private @triton_shared_matmul_f32(memref<?x?xf32, strided<[?, ?], offset: ?>>, memref<?x?xf32, strided<[?, ?], offset: ?>>, memref<?x?xf32, strided<[?, ?], offset: ?>>) attributes {llvm.emit_c_interface}
+// CHECK-DAG:   func.func private @triton_shared_matmul_bf16_f32(memref<?x?xbf16, strided<[?, ?], offset: ?>>, memref<?x?xbf16, strided<[?, ?], offset: ?>>, memref<?x?xf32, strided<[?, ?], offset: ?>>) attributes {llvm.emit_c_interface}
+// CHECK-DAG:   func.func private @triton_shared_matmul_f16_f32(memref<?x?xf16, strided<[?, ?], offset: ?>>, memref<?x?xf16, strided<[?, ?], offset: ?>>, memref<?x?xf32, strided<[?, ?], offset: ?>>) attributes {llvm.emit_c_interface}
+
+// CHECK-LABEL: func.func @f32(
+// CHECK-SAME:      %[[A:.*]]: memref<128x64xf32>, %[[B:.*]]: memref<64x32xf32, strided<[?, 1], offset: ?>>, %[[C:.*]]: memref<128x32xf32>)
+// CHECK-DAG:       %[[CAST_A:.*]] = memref.cast %[[A]] : memref<128x64xf32> to memref<?x?xf32, strided<[?, ?], offset: ?>>
+// CHECK-DAG:       %[[CAST_B:.*]] = memref.cast %[[B]] : memref<64x32xf32, strided<[?, 1], offset: ?>> to memref<?x?xf32, strided<[?, ?], offset: ?>>
+// CHECK-DAG:       %[[CAST_C:.*]] = memref.cast %[[C]] : memref<128x32xf32> to memref<?x?xf32, strided<[?, ?], offset: ?>>
+// CHECK:           call @triton_shared_matmul_f32(%[[CAST_A]], %[[CAST_B]], %[[CAST_C]])
+// CHECK-NOT:       linalg.matmul
+
+// CHECK-LABEL: func.func @bf16(
+// CHECK-SAME:      %[[A:.*]]: memref<?x?xbf16, strided<[?, ?], offset: ?>>, %[[B:.*]]: memref<?x?xbf16, strided<[?, ?], offset: ?>>, %[[C:.*]]: memref<?x?xf32, strided<[?, ?], offset: ?>>)
+// CHECK-NOT:       memref.cast
+// CHECK:           call @triton_shared_matmul_bf16_f32(%[[A]], %[[B]], %[[C]])
+
+// CHECK-LABEL: func.func @f16_twice(
+// CHECK:           call @triton_shared_matmul_f16_f32(
+// CHECK:           call @triton_shared_matmul_f16_f32(
+// CHECK-NOT:       linalg.matmul
+
+// CHECK-LABEL: func.func @f16_result(
+// CHECK:           linalg.matmul
+
+// CHECK-LABEL: func.func @i8(
+// CHECK:           linalg.matmul
+
+// CHECK-LABEL: func.func @tensors(
+// CHECK:           linalg.matmul
@@ -0,0 +1,59 @@
+// RUN: triton-shared-opt --triton-shared-tile-and-fuse="cache-size=65536" %s | FileCheck %s
+
+#map = affine_map<(d0, d1) -> (d0, d1)>
+module {
+  // A row of the chain touches 5 KiB: two inputs and an output for the
+  // multiplication, an input and an output for the exponential. 64 KiB hold
+  // 8 whole rows, so the chain is tiled by rows and the multiplication fused
+  // into the loop.
+  func.func @chain(%arg0: tensor<256x256xf32>, %arg1: tensor<256x256xf32>) -> tensor<256x256xf32> {
+    %0 = tensor.empty() : tensor<256x256xf32>
+    %1 = linalg.generic {indexing_maps = [#map, #map, #map], iterator_types = ["parallel", "parallel"]} ins(%arg0, %arg1 : tensor<256x256xf32>, tensor<256x256xf32>) outs(%0 : tensor<256x256xf32>) {
+    ^bb0(%in: f32, %in_0: f32, %out: f32):
+      %3 = arith.mulf %in, %in_0 : f32
+      linalg.yield %3 : f32
+    } -> tensor<256x256xf32>
+    %2 = linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel", "parallel"]} ins(%1 : tensor<256x256xf32>) outs(%0 : tensor<256x256xf32>) {
+    ^bb0(%in: f32, %out: f32):
+      %3 = math.exp %in : f32
+      linalg.yield %3 : f32
+    } -> tensor<256x256xf32>
+    return %2 : tensor<256x256xf32>
+  }
+  func.func @small(%arg0: tensor<16x16xf32>) -> tensor<16x16xf32> {
+    %0 = tensor.empty() : tensor<16x16xf32>
+    %1 = linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel", "parallel"]} ins(%arg0 : tensor<16x16xf32>) outs(%0 : tensor<16x16xf32>) {
+    ^bb0(%in: f32, %out: f32):
+      %2 = math.exp %in : f32
+      linalg.yield %2 : f32
+    } -> tensor<16x16xf32>
+    return %1 : tensor<16x16xf32>
+  }
+  func.func @row_sum(%arg0: tensor<256x256xf32>, %arg1: tensor<256xf32>) -> tensor<256xf32> {
+    %reduced = linalg.reduce ins(%arg0 : tensor<256x256xf32>) outs(%arg1 : tensor<256xf32>) dimensions = [1]
+      (%in: f32, %init: f32) {
+        %0 = arith.addf %in, %init : f32
+        linalg.yield %0 : f32
+      }
+    return %reduced : tensor<256xf32>
+  }
+}
+
+// CHECK-LABEL: func.func @chain(
+// CHECK-DAG:       %[[C8:.*]] = arith.constant 8 : index
+// CHECK-DAG:       %[[C256:.*]] = arith.constant 256 : index
+// CHECK:           scf.for %[[IV:.*]] = %{{.*}} to %[[C256]] step %[[C8]]
+// CHECK:             tensor.extract_slice %{{.*}}[%[[IV]], 0] [8, 256] [1, 1]
+// CHECK:             arith.mulf
+// CHECK:             math.exp
+// CHECK:             tensor.insert_slice %{{.*}}[%[[IV]], 0] [8, 256] [1, 1]
+// CHECK-NOT:       linalg.generic
+
+// CHECK-LABEL: func.func @small(
+// CHECK-NOT:       scf.for
+// CHECK:           linalg.generic
+
+// Reduction loops are not tiled.
+// CHECK-LABEL: func.func @row_sum(
+// CHECK:           scf.for
+// CHECK:             linalg.reduce ins(%{{.*}} : tensor<{{[0-9]+}}x256xf32>)
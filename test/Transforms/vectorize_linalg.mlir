@@ -0,0 +1,80 @@
+// RUN: triton-shared-opt --triton-shared-vectorize-linalg="vector-bits=256" %s | FileCheck %s
+
+#map = affine_map<(d0, d1) -> (d0, d1)>
+module {
+  func.func @add(%arg0: tensor<4x16xf32>, %arg1: tensor<4x16xf32>) -> tensor<4x16xf32> {
+    %0 = tensor.empty() : tensor<4x16xf32>
+    %1 = linalg.generic {indexing_maps = [#map, #map, #map], iterator_types = ["parallel", "parallel"]} ins(%arg0, %arg1 : tensor<4x16xf32>, tensor<4x16xf32>) outs(%0 : tensor<4x16xf32>) {
+    ^bb0(%in: f32, %in_0: f32, %out: f32):
+      %2 = arith.addf %in, %in_0 : f32
+      linalg.yield %2 : f32
+    } -> tensor<4x16xf32>
+    return %1 : tensor<4x16xf32>
+  }
+  func.func @tail(%arg0: tensor<20xf32>) -> tensor<20xf32> {
+    %0 = tensor.empty() : tensor<20xf32>
+    %1 = linalg.generic {indexing_maps = [affine_map<(d0) -> (d0)>, affine_map<(d0) -> (d0)>], iterator_types = ["parallel"]} ins(%arg0 : tensor<20xf32>) outs(%0 : tensor<20xf32>) {
+    ^bb0(%in: f32, %out: f32):
+      %2 = math.exp %in : f32
+      linalg.yield %2 : f32
+    } -> tensor<20xf32>
+    return %1 : tensor<20xf32>
+  }
+  func.func @row_sum(%arg0: tensor<4x16xf32>, %arg1: tensor<4xf32>) -> tensor<4xf32> {
+    %reduced = linalg.reduce ins(%arg0 : tensor<4x16xf32>) outs(%arg1 : tensor<4xf32>) dimensions = [1]
+      (%in: f32, %init: f32) {
+        %0 = arith.addf %in, %init : f32
+        linalg.yield %0 : f32
+      }
+    return %reduced : tensor<4xf32>
+  }
+  func.func @small(%arg0: tensor<4xi64>) -> tensor<4xi64> {
+    %0 = tensor.empty() : tensor<4xi64>
+    %1 = linalg.generic {indexing_maps = [affine_map<(d0) -> (d0)>, affine_map<(d0) -> (d0)>], iterator_types = ["parallel"]} ins(%arg0 : tensor<4xi64>) outs(%0 : tensor<4xi64>) {
+    ^bb0(%in: i64, %out: i64):
+      %2 = arith.addi %in, %in : i64
+      linalg.yield %2 : i64
+    } -> tensor<4xi64>
+    return %1 : tensor<4xi64>
+  }
+  func.func @matmul(%arg0: tensor<8x8xf32>, %arg1: tensor<8x8xf32>, %arg2: tensor<8x8xf32>) -> tensor<8x8xf32> {
+    %0 = linalg.matmul ins(%arg0, %arg1 : tensor<8x8xf32>, tensor<8x8xf32>) outs(%arg2 : tensor<8x8xf32>) -> tensor<8x8xf32>
+    return %0 : tensor<8x8xf32>
+  }
+}
+
+// 256-bit vectors hold 8 f32, so each row is covered by two vectors.
+// CHECK-LABEL: func.func @add(
+// CHECK:           scf.for
+// CHECK:             scf.for
+// CHECK:               vector.transfer_read {{.*}} : tensor<{{.*}}>, vector<8xf32>
+// CHECK:               vector.transfer_read {{.*}} : tensor<{{.*}}>, vector<8xf32>
+// CHECK:               arith.addf {{.*}} : vector<8xf32>
+// CHECK:               vector.transfer_write {{.*}} : vector<8xf32>, tensor<{{.*}}>
+// CHECK-NOT:       linalg.generic
+
+// The last vector of 20 elements is masked.
+// CHECK-LABEL: func.func @tail(
+// CHECK:           scf.for
+// CHECK:             vector.create_mask
+// CHECK:             vector.transfer_read {{.*}} : tensor<{{.*}}>, vector<8xf32>
+// CHECK:             math.exp {{.*}} : vector<8xf32>
+// CHECK:             vector.transfer_write
+// CHECK-NOT:       linalg.generic
+
+// CHECK-LABEL: func.func @row_sum(
+// CHECK:           scf.for
+// CHECK:             scf.for
+// CHECK:               vector.transfer_read {{.*}} : tensor<{{.*}}>, vector<8xf32>
+// CHECK:               vector.reduction <add>, {{.*}} : vector<8xf32> into f32
+// CHECK-NOT:       linalg.reduce
+
+// Ops that fit in one vector are vectorized without loops.
+// CHECK-LABEL: func.func @small(
+// CHECK-NOT:       scf.for
+// CHECK:           arith.addi {{.*}} : vector<4xi64>
+// CHECK-NOT:       linalg.generic
+
+// Contractions are left alone.
+// CHECK-LABEL: func.func @matmul(
+// CHECK:           linalg.matmul
@@ -24,7 +24,11 @@
 #include "triton-shared/Conversion/TritonToUnstructured/Passes.h"
 #include "triton-shared/Dialect/TritonStructured/IR/TritonStructuredDialect.h"
 #include "triton-shared/Dialect/TritonTilingExt/IR/TritonTilingExtDialect.h"
+#include "triton-shared/Pipelines/Pipelines.h"
+#include "triton-shared/Transforms/Passes.h"
 
+#include "mlir/InitAllDialects.h"
+#include "mlir/InitAllExtensions.h"
 #include "mlir/InitAllPasses.h"
 
 namespace mlir {
@@ -47,6 +51,8 @@ inline void registerTritonSharedDialects(mlir::DialectRegistry &registry) {
   mlir::test::registerTestMembarPass();
   mlir::triton::registerTritonToLinalgPass();
   mlir::triton::registerTritonToLinalgExperimentalPass();
+  mlir::triton::registerCPUPipeline();
+  mlir::triton::registerTritonSharedTransformsPasses();
   mlir::triton::registerTritonToStructuredPass();
   mlir::triton::registerTritonPtrToMemref();
   mlir::triton::registerUnstructuredToMemref();
@@ -64,4 +70,9 @@ inline void registerTritonSharedDialects(mlir::DialectRegistry &registry) {
       mlir::linalg::LinalgDialect, mlir::func::FuncDialect,
       mlir::tensor::TensorDialect, mlir::memref::MemRefDialect,
       mlir::bufferization::BufferizationDialect>();
+
+  // The CPU pipeline bufferizes and lowers to LLVM through the interfaces of
+  // the upstream dialects.
+  mlir::registerAllDialects(registry);
+  mlir::registerAllExtensions(registry);
 }
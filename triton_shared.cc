@@ -1,8 +1,552 @@
-﻿#include <pybind11/pybind11.h>
+#include "Runtime/GridExecutor.h"
+#include "Runtime/KernelLoader.h"
+#include "Runtime/LaunchGraph.h"
+#include "Runtime/Launcher.h"
+#include "Runtime/Memory.h"
+#include "Runtime/Stream.h"
+#include "Runtime/Topology.h"
+
+#include "triton-shared/Conversion/TritonToLinalgExperimental/TritonToLinalgExperimental.h"
+#include "triton-shared/Dialect/TritonStructured/IR/TritonStructuredDialect.h"
+#include "triton-shared/Dialect/TritonTilingExt/IR/TritonTilingExtDialect.h"
+#include "triton-shared/Pipelines/Pipelines.h"
+#include "triton-shared/Transforms/Passes.h"
+
+#include "mlir/Bytecode/BytecodeWriter.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/InitAllDialects.h"
+#include "mlir/InitAllExtensions.h"
+#include "mlir/InitAllPasses.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Parser/Parser.h"
+#include "mlir/Pass/PassRegistry.h"
+
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/TargetParser/Host.h"
+
+#include <pybind11/pybind11.h>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace py = pybind11;
+using namespace triton_shared;
+
+namespace {
+
+void *getPointer(py::handle obj) {
+  if (PyLong_Check(obj.ptr()))
+    return reinterpret_cast<void *>(PyLong_AsUnsignedLongLong(obj.ptr()));
+  if (obj.is_none())
+    return nullptr;
+  if (!py::hasattr(obj, "data_ptr"))
+    throw py::type_error(
+        "Pointer argument must be either uint64 or have data_ptr method");
+  py::object ptr = obj.attr("data_ptr")();
+  if (!PyLong_Check(ptr.ptr()))
+    throw py::type_error(
+        "data_ptr method of Pointer object must return 64-bit int");
+  return reinterpret_cast<void *>(PyLong_AsUnsignedLongLong(ptr.ptr()));
+}
+
+KernelArguments marshalArguments(const std::string &signature,
+                                 const py::tuple &args) {
+  if (args.size() != signature.size())
+    throw py::value_error("kernel expects " + std::to_string(signature.size()) +
+                          " arguments but got " + std::to_string(args.size()));
+  for (char kind : signature)
+    if (!isValidArgKind(kind))
+      throw py::value_error("invalid kernel signature '" + signature + "'");
+
+  KernelArguments result(signature);
+  for (size_t i = 0; i < signature.size(); ++i) {
+    py::handle arg = args[i];
+    switch (signature[i]) {
+    case 'P':
+      result.setPointer(i, getPointer(arg));
+      break;
+    case 'O':
+      break;
+    case 'b':
+      result.setScalar(i, arg.cast<int8_t>());
+      break;
+    case 'h':
+      result.setScalar(i, arg.cast<int16_t>());
+      break;
+    case 'i':
+      result.setScalar(i, arg.cast<int32_t>());
+      break;
+    case 'l':
+      result.setScalar(i, arg.cast<int64_t>());
+      break;
+    case 'B':
+      result.setScalar(i, arg.cast<uint8_t>());
+      break;
+    case 'H':
+      result.setScalar(i, arg.cast<uint16_t>());
+      break;
+    case 'I':
+      result.setScalar(i, arg.cast<uint32_t>());
+      break;
+    case 'K':
+      result.setScalar(i, arg.cast<uint64_t>());
+      break;
+    case 'f':
+      result.setScalar(i, arg.cast<float>());
+      break;
+    case 'd':
+      result.setScalar(i, arg.cast<double>());
+      break;
+    }
+  }
+  return result;
+}
+
+// A stream handed out to Python. Launches enqueued on the stream outlive the
+// Python call, so the stream also keeps their arguments alive until they have
+// completed. Only touched with the GIL held, unlike `stream`.
+struct PyStream {
+  Stream stream;
+  std::deque<std::pair<uint64_t, py::object>> pendingArgs;
+
+  void releaseCompletedArgs() {
+    uint64_t completed = stream.getCompleted();
+    while (!pendingArgs.empty() && pendingArgs.front().first <= completed)
+      pendingArgs.pop_front();
+  }
+
+  void synchronize() {
+    {
+      py::gil_scoped_release release;
+      stream.synchronize();
+    }
+    releaseCompletedArgs();
+  }
+
+  ~PyStream() {
+    py::gil_scoped_release release;
+    stream.synchronize();
+  }
+};
+
+// A launch graph handed out to Python, which also keeps the arguments of the
+// recorded launches alive.
+struct PyGraph {
+  LaunchGraph graph;
+  std::vector<py::object> args;
+};
+
+void runKernel(const KernelArguments &kernelArgs, PackedKernelFn fn, int gridX,
+               int gridY, int gridZ, bool gridAsLoop) {
+  if (gridAsLoop)
+    kernelArgs.launchRange(fn, gridX, gridY, gridZ);
+  else
+    kernelArgs.launch(fn, gridX, gridY, gridZ);
+}
+
+void init_triton_shared_runtime(py::module &&m) {
+  m.def(
+      "get_cpu_properties",
+      [] {
+        const CPUTopology &topology = getCPUTopology();
+        py::dict properties;
+        properties["num_threads"] = GridExecutor::get().getNumThreads();
+        properties["num_cpus"] = topology.getNumCPUs();
+        properties["num_physical_cores"] = topology.numPhysicalCores;
+        properties["threads_per_core"] = topology.getThreadsPerCore();
+        properties["num_numa_nodes"] = topology.nodes.size();
+        properties["l1_cache_size"] = topology.l1CacheSize;
+        properties["l2_cache_size"] = topology.l2CacheSize;
+        properties["l3_cache_size"] = topology.l3CacheSize;
+        properties["cache_line_size"] = topology.cacheLineSize;
+        properties["simd_width"] = topology.simdWidth;
+        return properties;
+      },
+      "Returns the topology of the host CPU the kernels run on");
+
+  m.def(
+      "get_memory_stats",
+      [] {
+        py::dict stats;
+        stats["system_blocks"] = getNumSystemBlocks();
+        stats["peak_system_blocks"] = getPeakNumSystemBlocks();
+        return stats;
+      },
+      "Returns statistics of the memory the runtime holds for kernel "
+      "buffers");
+
+  m.def("reset_peak_memory_stats", &resetPeakNumSystemBlocks,
+        "Resets peak_system_blocks of get_memory_stats to the blocks held "
+        "now");
+
+  py::class_<Event>(m, "Event")
+      .def(py::init<>())
+      .def("query", &Event::query,
+           "Returns True if the work captured by the last record has "
+           "completed")
+      .def("synchronize", &Event::synchronize,
+           py::call_guard<py::gil_scoped_release>(),
+           "Waits for the work captured by the last record to complete");
+
+  // Launches take the Stream object itself rather than its address, so they
+  // can never reach a collected stream; collecting a stream waits for the work
+  // enqueued on it.
+  py::class_<PyStream>(m, "Stream")
+      .def(py::init<>())
+      .def("query",
+           [](PyStream &self) {
+             self.releaseCompletedArgs();
+             return self.stream.query();
+           },
+           "Returns True if all the enqueued work has completed")
+      .def("synchronize", &PyStream::synchronize,
+           "Waits for all the enqueued work to complete")
+      .def("record_event",
+           [](PyStream &self, Event &event) { self.stream.recordEvent(event); },
+           "Captures the work enqueued so far in the event")
+      .def("wait_event",
+           [](PyStream &self, const Event &event) {
+             self.stream.waitEvent(event);
+           },
+           "Holds back the work enqueued from now on until the event has "
+           "completed");
+
+  m.def(
+      "load_kernel",
+      [](py::bytes kernel, const std::string &symbol) {
+        std::string object(kernel);
+        // Linking, or compiling the IR with ORC, can take a while; other
+        // Python threads keep running meanwhile.
+        py::gil_scoped_release release;
+        auto address = KernelLoader::get().loadKernel(object, symbol);
+        if (!address)
+          throw std::runtime_error("failed to load kernel '" + symbol +
+                                   "': " + llvm::toString(address.takeError()));
+        return reinterpret_cast<uintptr_t>(*address);
+      },
+      "Links a kernel object, or JIT-compiles kernel LLVM IR, into the process "
+      "and returns the address of the given symbol");
+
+  py::class_<PyGraph>(m, "Graph")
+      .def(py::init<>())
+      .def("__len__", [](const PyGraph &self) { return self.graph.size(); })
+      .def(
+          "add_launch",
+          [](PyGraph &self, uintptr_t function, const std::string &signature,
+             int gridX, int gridY, int gridZ, const py::tuple &args,
+             bool gridAsLoop) {
+            self.graph.addLaunch(reinterpret_cast<PackedKernelFn>(function),
+                                 marshalArguments(signature, args), gridX,
+                                 gridY, gridZ, gridAsLoop);
+            self.args.push_back(args);
+          },
+          py::arg("function"), py::arg("signature"), py::arg("gridX"),
+          py::arg("gridY"), py::arg("gridZ"), py::arg("args"),
+          py::arg("grid_as_loop") = false,
+          "Records a launch, taking the same arguments as launch")
+      .def(
+          "replay",
+          [](py::object self, PyStream *stream) {
+            // Replay a snapshot, taken while holding the GIL, which launches
+            // recorded meanwhile by other threads leave alone.
+            auto snapshot = std::make_shared<const LaunchGraph>(
+                self.cast<PyGraph &>().graph);
+            if (stream) {
+              // The stream keeps the graph, and with it the arguments, alive
+              // until the replay has run.
+              uint64_t sequence = stream->stream.enqueue(
+                  [snapshot] { snapshot->replay(); });
+              stream->pendingArgs.emplace_back(sequence, self);
+              stream->releaseCompletedArgs();
+              return;
+            }
+            py::gil_scoped_release release;
+            snapshot->replay();
+          },
+          py::arg("stream") = nullptr,
+          "Runs the recorded launches in order. With a stream, enqueues the "
+          "replay on it and returns right away");
+
+  m.def(
+      "launch",
+      [](uintptr_t function, const std::string &signature, int gridX,
+         int gridY, int gridZ, const py::tuple &args, bool gridAsLoop,
+         PyStream *stream) {
+        auto fn = reinterpret_cast<PackedKernelFn>(function);
+        if (stream) {
+          auto kernelArgs = std::make_shared<KernelArguments>(
+              marshalArguments(signature, args));
+          uint64_t sequence = stream->stream.enqueue(
+              [kernelArgs, fn, gridX, gridY, gridZ, gridAsLoop] {
+                runKernel(*kernelArgs, fn, gridX, gridY, gridZ, gridAsLoop);
+              });
+          stream->pendingArgs.emplace_back(sequence, args);
+          stream->releaseCompletedArgs();
+          return;
+        }
+
+        KernelArguments kernelArgs = marshalArguments(signature, args);
+        // The arguments are marshaled, the kernel does not touch Python
+        // objects: let other Python threads run, and launch, meanwhile.
+        py::gil_scoped_release release;
+        runKernel(kernelArgs, fn, gridX, gridY, gridZ, gridAsLoop);
+      },
+      py::arg("function"), py::arg("signature"), py::arg("gridX"),
+      py::arg("gridY"), py::arg("gridZ"), py::arg("args"),
+      py::arg("grid_as_loop") = false, py::arg("stream") = nullptr,
+      "Runs a packed kernel entry point over a launch grid. Kernels compiled "
+      "with grid-as-loop take a range of programs per call. With a stream, "
+      "enqueues the launch on it and returns right away");
+}
+
+void init_triton_shared_passes(py::module &&m) {
+  m.def("add_triton_to_linalg_experimental", [](mlir::PassManager &pm) {
+    pm.addPass(mlir::triton::createTritonToLinalgExperimentalPass());
+  });
+
+  // Passes and pipelines are added by name, e.g. the CPU lowering
+  // 'triton-shared-cpu-pipeline{vectorize=true}', so the exact same pipeline
+  // can be reproduced with triton-shared-opt.
+  m.def(
+      "add_pipeline",
+      [](mlir::PassManager &pm, const std::string &pipeline) {
+        static std::once_flag registered;
+        std::call_once(registered, [] {
+          mlir::registerAllPasses();
+          mlir::triton::registerTritonSharedTransformsPasses();
+          mlir::triton::registerCPUPipeline();
+        });
+
+        std::string error;
+        llvm::raw_string_ostream os(error);
+        if (mlir::failed(mlir::parsePassPipeline(pipeline, pm, os)))
+          throw std::invalid_argument("invalid pass pipeline '" + pipeline +
+                                      "': " + os.str());
+      },
+      "Appends a textual pass pipeline, e.g. 'lower-affine,cse', to the pass "
+      "manager");
+
+  // Unlike ir.pass_manager.run, releases the GIL so that kernels can be
+  // compiled from several Python threads at once.
+  m.def("run", [](mlir::PassManager &pm, mlir::ModuleOp &mod) {
+    py::gil_scoped_release release;
+    if (mlir::failed(pm.run(mod.getOperation())))
+      throw std::runtime_error("PassManager::run failed");
+  });
+}
+
+llvm::OptimizationLevel getOptimizationLevel(int optLevel) {
+  switch (optLevel) {
+  case 0:
+    return llvm::OptimizationLevel::O0;
+  case 1:
+    return llvm::OptimizationLevel::O1;
+  case 2:
+    return llvm::OptimizationLevel::O2;
+  default:
+    return llvm::OptimizationLevel::O3;
+  }
+}
+
+std::unique_ptr<llvm::Module> parseLLIR(const std::string &llir,
+                                        llvm::LLVMContext &context) {
+  llvm::SMDiagnostic diagnostic;
+  std::unique_ptr<llvm::Module> module =
+      llvm::parseAssemblyString(llir, diagnostic, context);
+  if (!module) {
+    std::string message;
+    llvm::raw_string_ostream os(message);
+    diagnostic.print("llir", os);
+    throw std::runtime_error("failed to parse LLVM IR: " + os.str());
+  }
+  return module;
+}
+
+std::string printLLIR(const llvm::Module &module) {
+  std::string result;
+  llvm::raw_string_ostream os(result);
+  module.print(os, nullptr);
+  return os.str();
+}
+
+// Targets `llir` at `cpu` with the extra `features` and runs the default LLVM
+// optimization pipeline of `optLevel` on it. The target is recorded as
+// function attributes, so that llc and the JIT generate code for it too.
+std::string optimizeLLIR(const std::string &llir, const std::string &cpu,
+                         const std::string &features, int optLevel) {
+  static std::once_flag initialized;
+  std::call_once(initialized, [] {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+  });
+
+  llvm::LLVMContext context;
+  std::unique_ptr<llvm::Module> module = parseLLIR(llir, context);
+
+  std::string triple = llvm::sys::getProcessTriple();
+  std::string error;
+  const llvm::Target *target = llvm::TargetRegistry::lookupTarget(triple, error);
+  if (!target)
+    throw std::runtime_error("no target for '" + triple + "': " + error);
+  std::unique_ptr<llvm::TargetMachine> machine(target->createTargetMachine(
+      triple, cpu, features, llvm::TargetOptions(), llvm::Reloc::PIC_,
+      std::nullopt, llvm::CodeGenOptLevel::Aggressive));
+  module->setTargetTriple(triple);
+  module->setDataLayout(machine->createDataLayout());
+
+  for (llvm::Function &fn : *module) {
+    if (fn.isDeclaration())
+      continue;
+    if (!cpu.empty())
+      fn.addFnAttr("target-cpu", cpu);
+    if (!features.empty()) {
+      // Keep the features requested by the lowering, e.g. through the
+      // target-features option of triton-shared-cpu-pipeline.
+      std::string fnFeatures = features;
+      if (fn.hasFnAttribute("target-features"))
+        fnFeatures =
+            fn.getFnAttribute("target-features").getValueAsString().str() +
+            "," + features;
+      fn.addFnAttr("target-features", fnFeatures);
+    }
+  }
+
+  if (optLevel > 0) {
+    llvm::LoopAnalysisManager lam;
+    llvm::FunctionAnalysisManager fam;
+    llvm::CGSCCAnalysisManager cgam;
+    llvm::ModuleAnalysisManager mam;
+    llvm::PassBuilder pb(machine.get());
+    pb.registerModuleAnalyses(mam);
+    pb.registerCGSCCAnalyses(cgam);
+    pb.registerFunctionAnalyses(fam);
+    pb.registerLoopAnalyses(lam);
+    pb.crossRegisterProxies(lam, fam, cgam, mam);
+    llvm::ModulePassManager mpm =
+        pb.buildPerModuleDefaultPipeline(getOptimizationLevel(optLevel));
+    mpm.run(*module, mam);
+  }
+
+  return printLLIR(*module);
+}
+
+// Adds the packed entry point `void _mlir_<name>(ptr %args)` of kernel `name`
+// to `llir`, where args[i] holds the address of the i-th kernel argument: the
+// convention of the packed functions of the MLIR ExecutionEngine, which the
+// runtime launches kernels through. See Runtime/Launcher.h.
+std::string addPackedEntry(const std::string &llir, const std::string &name) {
+  llvm::LLVMContext context;
+  std::unique_ptr<llvm::Module> module = parseLLIR(llir, context);
+  llvm::Function *kernel = module->getFunction(name);
+  if (!kernel || kernel->isDeclaration())
+    throw std::runtime_error("no kernel '" + name + "' in the LLVM IR");
+
+  llvm::Type *ptrType = llvm::PointerType::getUnqual(context);
+  auto *entryType = llvm::FunctionType::get(llvm::Type::getVoidTy(context),
+                                            {ptrType}, /*isVarArg=*/false);
+  llvm::Function *entry =
+      llvm::Function::Create(entryType, llvm::GlobalValue::ExternalLinkage,
+                             "_mlir_" + name, *module);
+  llvm::IRBuilder<> builder(llvm::BasicBlock::Create(context, "entry", entry));
+  llvm::Value *args = entry->getArg(0);
+  llvm::SmallVector<llvm::Value *> callArgs;
+  for (llvm::Argument &arg : kernel->args()) {
+    llvm::Value *slot =
+        builder.CreateConstInBoundsGEP1_64(ptrType, args, arg.getArgNo());
+    llvm::Value *address = builder.CreateLoad(ptrType, slot);
+    callArgs.push_back(builder.CreateLoad(arg.getType(), address));
+  }
+  builder.CreateCall(kernel, callArgs);
+  builder.CreateRetVoid();
+  return printLLIR(*module);
+}
+
+void init_triton_shared_llvm(py::module &&m) {
+  m.def("get_host_cpu_name", [] { return llvm::sys::getHostCPUName().str(); });
+
+  m.def("get_host_cpu_features", [] {
+    std::string features;
+    for (const auto &feature : llvm::sys::getHostCPUFeatures()) {
+      if (!features.empty())
+        features += ",";
+      features += (feature.getValue() ? "+" : "-") + feature.getKey().str();
+    }
+    return features;
+  });
+
+  m.def(
+      "optimize_module",
+      [](const std::string &llir, const std::string &cpu,
+         const std::string &features, int optLevel) {
+        py::gil_scoped_release release;
+        return optimizeLLIR(llir, cpu, features, optLevel);
+      },
+      "Optimizes textual LLVM IR for the given CPU and features of the host "
+      "architecture");
+
+  m.def(
+      "add_packed_entry",
+      [](const std::string &llir, const std::string &name) {
+        py::gil_scoped_release release;
+        return addPackedEntry(llir, name);
+      },
+      "Adds the packed entry point _mlir_<name>, which the CPU runtime "
+      "launches, to textual LLVM IR containing kernel <name>");
+}
+
+} // namespace
+
+// Compilation of the CPU backend runs in process on the module handed over by
+// Triton, the runtime loads and launches the compiled kernels.
+void init_triton_triton_shared(py::module &&m) {
+  m.def("load_dialects", [](mlir::MLIRContext &context) {
+    mlir::DialectRegistry registry;
+    registry.insert<mlir::ttx::TritonTilingExtDialect,
+                    mlir::tts::TritonStructuredDialect>();
+    // The lowering goes through most upstream dialects and relies on their
+    // bufferization and LLVM conversion interfaces.
+    mlir::registerAllDialects(registry);
+    mlir::registerAllExtensions(registry);
+    context.appendDialectRegistry(registry);
+    context.loadAllAvailableDialects();
+  });
+
+  // Modules handed to and from the external tools are exchanged as MLIR
+  // bytecode, which is much faster to write and read than the textual form.
+  m.def("write_bytecode", [](mlir::ModuleOp &mod) {
+    std::string bytecode;
+    llvm::raw_string_ostream os(bytecode);
+    if (mlir::failed(mlir::writeBytecodeToFile(mod, os)))
+      throw std::runtime_error("failed to write MLIR bytecode");
+    return py::bytes(os.str());
+  });
+
+  m.def(
+      "parse_bytecode",
+      [](py::bytes bytecode, mlir::MLIRContext &context) {
+        mlir::OwningOpRef<mlir::ModuleOp> module =
+            mlir::parseSourceString<mlir::ModuleOp>(std::string(bytecode),
+                                                    &context);
+        if (!module)
+          throw std::runtime_error("failed to parse MLIR bytecode");
+        return module->clone();
+      },
+      py::return_value_policy::take_ownership);
 
-// The CPU backend with triton_shared doesn't do compilation from within python
-// but rather externally through triton-shared-opt, so we leave this function
-// blank.
-void init_triton_triton_shared(py::module &&m) {}
+  init_triton_shared_passes(m.def_submodule("passes"));
+  init_triton_shared_llvm(m.def_submodule("llvm"));
+  init_triton_shared_runtime(m.def_submodule("runtime"));
+}